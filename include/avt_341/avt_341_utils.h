@@ -24,10 +24,10 @@ struct vec2{
 		x = x_; 
 		y = y_;
 	}
-	vec2 operator+(const vec2& b) { return vec2(this->x + b.x, this->y + b.y); }
-	vec2 operator-(const vec2& b) { return vec2(this->x - b.x, this->y - b.y); }
-	vec2 operator*(const float s) { return vec2(s*this->x, s*this->y); }
-	vec2 operator/(const float s) { return vec2(this->x/s, this->y/s); }
+	vec2 operator+(const vec2& b) const { return vec2(this->x + b.x, this->y + b.y); }
+	vec2 operator-(const vec2& b) const { return vec2(this->x - b.x, this->y - b.y); }
+	vec2 operator*(const float s) const { return vec2(s*this->x, s*this->y); }
+	vec2 operator/(const float s) const { return vec2(this->x/s, this->y/s); }
 	float x;
 	float y;
 };
@@ -115,6 +115,22 @@ inline float PointToSegmentDistance(vec2 ep1, vec2 ep2, vec2 p) {
 	return d0;
 }
 
+/**
+ * Return the signed Menger curvature of three points, the inverse radius of
+ * the circle through them, positive when they turn to the left.
+ * Repeated points give no curvature.
+ * \param a First point
+ * \param b Middle point
+ * \param c Last point
+ */
+inline float MengerCurvature(vec2 a, vec2 b, vec2 c) {
+	vec2 ab = b - a;
+	vec2 ac = c - a;
+	float denom = length(ab) * length(c - b) * length(ac);
+	if (denom <= 0.0f) return 0.0f;
+	return 2.0f*(ab.x*ac.y - ab.y*ac.x) / denom;
+}
+
 inline float GetHeadingFromOrientation(avt_341::msg::Quaternion orientation){
     avt_341::msg_tf::Quaternion q(
         orientation.x,
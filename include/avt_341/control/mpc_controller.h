@@ -0,0 +1,182 @@
+/**
+* \class MpcController
+*
+* A model predictive path tracking controller, an alternative to the
+* PurePursuitController for Ackermann vehicles.
+*
+* The steering is optimized over a short horizon with the kinematic bicycle
+* model linearized about the path, where the state is the lateral and
+* heading error to the path and the path curvature enters as a known
+* disturbance. The errors are affine in the steering angles, so the problem
+* is a box constrained QP of fixed size, condensed to the steering angles
+* only. It is solved by an accelerated projected gradient method that
+* starts from the previous solution shifted forward in time and stops after a
+* fixed number of iterations, without allocating memory.
+* The speed is controlled by a PID controller like the pure pursuit controller.
+*
+* \date 10/17/2026
+*/
+#ifndef MPC_CONTROLLER_H
+#define MPC_CONTROLLER_H
+
+#include <vector>
+#include "avt_341/control/pid_controller.h"
+#include "avt_341/control/path_tracker.h"
+#include "avt_341/node/ros_types.h"
+#include "avt_341/avt_341_utils.h"
+
+namespace avt_341 {
+namespace control{
+
+class MpcController {
+public:
+	/// Create a controller
+	MpcController();
+
+	/**
+	* Set the trajectory to follow. It is converted once to a polyline
+	* with cumulative lengths and curvatures.
+	* \param traj The desired trajectory
+	*/
+	void SetPath(const avt_341::msg::Path &traj);
+
+	/**
+	* Calculate a driving command following the last trajectory set with SetPath.
+	* \param goal The point of the path at the end of the horizon
+	*/
+	avt_341::msg::Twist GetDcFromPath(utils::vec2 & goal);
+
+	/// Get the index of the path segment closest to the vehicle at the last command, -1 before any
+	int GetTrackIndex() const { return tracker_.GetTrackIndex(); }
+
+	/**
+	 *  Set the vehicle position, orientation and speed
+	 * \param state The vehicle state
+	 */
+	void SetVehicleState(avt_341::msg::Odometry state);
+
+	/**
+	* Set the wheelbase of the vehicle in meters
+	* \param wb Wheelbase to set
+	*/
+	void SetWheelbase(float wb) { wheelbase_ = wb; }
+
+	/**
+	* Set the max steering angle of the vehicle in radians
+	* \param st Max steering angle
+	*/
+	void SetMaxSteering(float st) { max_steering_angle_ = st; }
+
+	/**
+	* Set the time step of the horizon, the horizon is 20 steps long
+	* \param dt Time step in seconds
+	*/
+	void SetTimeStep(float dt) { dt_ = dt; }
+
+	/**
+	* Set the time between commands, used to move the previous solution forward
+	* \param period Time in seconds
+	*/
+	void SetControlPeriod(float period) { control_period_ = period; }
+
+	/**
+	* Set the weights of the cost
+	* \param q_lateral Weight of the squared lateral error, per m^2
+	* \param q_heading Weight of the squared heading error, per rad^2
+	* \param r_steering Weight of the squared steering angle, per rad^2
+	* \param r_steering_rate Weight of the squared change of steering angle between steps, per rad^2
+	*/
+	void SetWeights(float q_lateral, float q_heading, float r_steering, float r_steering_rate) {
+		q_lateral_ = q_lateral;
+		q_heading_ = q_heading;
+		r_steering_ = r_steering;
+		r_steering_rate_ = r_steering_rate;
+	}
+
+	/**
+	* Set the iteration budget of the QP solver
+	* \param max_iterations Largest number of iterations per command
+	*/
+	void SetMaxIterations(int max_iterations) { max_iterations_ = max_iterations; }
+
+	/**
+	* Set the maximum allowed speed of the vehicle
+	* \param speed Maximum desired speed in m/s
+	*/
+	void SetMaxStableSpeed(float speed) { max_stable_speed_ = speed; }
+
+	/**
+	* Set the desired speed of the vehicle in m/s
+	* \param speed The desired speed
+	*/
+	void SetDesiredSpeed(float speed) {
+		desired_speed_ = speed;
+		speed_controller_.SetSetpoint(speed);
+	}
+
+	/**
+	* Set the coefficients of the PID speed controller
+	* \param kp Proportional coefficient
+	* \param ki Integral coefficient
+	* \param kd Derivative coefficient
+	*/
+	void SetSpeedControllerParams(float kp, float ki, float kd) {
+		speed_controller_.SetKp(kp);
+		speed_controller_.SetKi(ki);
+		speed_controller_.SetKd(kd);
+	}
+
+	/// Set a scale factor for the output throttle
+	void SetThrottleCoeff(float tc){ throttle_coeff_ = tc; }
+
+	/// Get a pointer to the PID speed controller
+	PidController *GetPidSpeedController(){ return &speed_controller_; }
+
+	/// Get the number of solver iterations of the last command
+	int GetLastIterations() const { return last_iterations_; }
+
+private:
+	static const int horizon_ = 20;
+
+	float CurvatureAt(float s, int &hint) const;
+	int SolveQp();
+
+	// path to follow, with its arc lengths, curvatures and segment closest to the vehicle
+	PathTracker tracker_;
+
+	// condensed QP, minimize u'Hu + 2f'u with |u| <= max steering
+	float h_[horizon_][horizon_];
+	float f_[horizon_];
+	// steering angles of the current and previous solution
+	float u_[horizon_];
+	bool warm_;
+	float last_steering_;
+	int last_iterations_;
+
+	float wheelbase_;
+	float max_steering_angle_;
+	float dt_;
+	float control_period_;
+	float q_lateral_;
+	float q_heading_;
+	float r_steering_;
+	float r_steering_rate_;
+	int max_iterations_;
+	float desired_speed_;
+	float max_stable_speed_;
+	float throttle_coeff_;
+	PidController speed_controller_;
+
+	//current vehicle state info
+	float veh_x_;
+	float veh_y_;
+	float veh_heading_;
+	float veh_speed_;
+	float vx_;
+	float vy_;
+};
+
+} // namespace control
+} // namespace avt_341
+
+#endif
@@ -0,0 +1,84 @@
+/**
+* \class PathTracker
+*
+* The path followed by a controller, converted once to a polyline with the
+* cumulative arc length and the signed curvature at each point, and the
+* segment closest to the vehicle.
+* The closest segment is tracked forward from the previous update, which
+* takes constant time on average. The whole path is searched on a new path,
+* and again when the vehicle gets farther from the tracked segment than the
+* closest it has been since the last search by the relock distance, for
+* example when the localization jumps or a path passing near itself was
+* tracked on the wrong pass.
+*
+* \date 10/17/2026
+*/
+#ifndef PATH_TRACKER_H
+#define PATH_TRACKER_H
+
+#include <vector>
+#include "avt_341/node/ros_types.h"
+#include "avt_341/avt_341_utils.h"
+
+namespace avt_341 {
+namespace control{
+
+class PathTracker {
+public:
+	/// Create a tracker with an empty path
+	PathTracker();
+
+	/**
+	* Set the path to follow, the tracking restarts from its closest segment
+	* \param traj The path
+	*/
+	void SetPath(const avt_341::msg::Path &traj);
+
+	/**
+	* Update the segment closest to a position
+	* \param pos The vehicle position in local ENU
+	*/
+	void Update(utils::vec2 pos);
+
+	/**
+	* Set how much farther than the closest it has been the vehicle may get
+	* from the tracked segment before the whole path is searched again
+	* \param d Distance in meters
+	*/
+	void SetRelockDistance(float d) { relock_dist_ = d; }
+
+	/// Get the index of the tracked segment, -1 before the first update on a path
+	int GetTrackIndex() const { return track_index_; }
+
+	/// Get the distance from the last position to the tracked segment in meters
+	float GetTrackDistance() const { return track_dist_; }
+
+	/// Get the number of points of the path
+	int Size() const { return (int)points_.size(); }
+
+	/// Get the points of the path
+	const std::vector<utils::vec2> &GetPoints() const { return points_; }
+
+	/// Get the arc length at each point of the path
+	const std::vector<float> &GetArcLengths() const { return s_; }
+
+	/// Get the signed curvature at each point of the path, positive to the left
+	const std::vector<float> &GetCurvatures() const { return k_; }
+
+private:
+	void Search(utils::vec2 pos);
+
+	std::vector<utils::vec2> points_;
+	std::vector<float> s_;
+	std::vector<float> k_;
+	int track_index_;
+	float track_dist_;
+	// closest distance to the tracked segment since the last full search
+	float lock_dist_;
+	float relock_dist_;
+};
+
+} // namespace control
+} // namespace avt_341
+
+#endif
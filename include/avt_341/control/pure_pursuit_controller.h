@@ -19,7 +19,9 @@
 #ifndef PURE_PURSUIT_CONTROLLER_H
 #define PURE_PURSUIT_CONTROLLER_H
 
+#include <vector>
 #include "avt_341/control/pid_controller.h"
+#include "avt_341/control/path_tracker.h"
 #include "avt_341/node/ros_types.h"
 #include "avt_341/avt_341_utils.h"
 
@@ -39,6 +41,23 @@ public:
 	*/
 	avt_341::msg::Twist GetDcFromTraj(avt_341::msg::Path traj, utils::vec2 & goal);
 
+	/**
+	* Set the trajectory to follow. It is converted once to a polyline
+	* with cumulative lengths, and the tracking restarts from its closest segment.
+	* \param traj The desired trajectory
+	*/
+	void SetPath(const avt_341::msg::Path &traj);
+
+	/**
+	* Calculate a driving command following the last trajectory set with SetPath.
+	* The closest segment is tracked forward from the previous call.
+	* \param goal The lookahead point that is steered to
+	*/
+	avt_341::msg::Twist GetDcFromPath(utils::vec2 & goal);
+
+	/// Get the index of the path segment closest to the vehicle at the last command, -1 before any
+	int GetTrackIndex() const { return tracker_.GetTrackIndex(); }
+
 	/**
 	* Set the wheelbase of the vehicle in meters
 	* \param wb Wheelbase to set
@@ -162,6 +181,9 @@ private:
 	avt_341::msg::Twist GetDcAckermann(float alpha, float lookahead, utils::vec2 curr_dir, float target_speed);
 	avt_341::msg::Twist GetDcSkid(float dx, float dy, float dtheta);
 
+	// path to follow and its segment closest to the vehicle
+	PathTracker tracker_;
+
 	// steering parameters for the skid steered model
 	float kx_;
 	float ky_;
@@ -0,0 +1,89 @@
+/**
+* \class StatePredictor
+*
+* Predicts the vehicle state a short time ahead of the last odometry,
+* so the controller can steer from where the vehicle will be when the
+* command takes effect. Ackermann vehicles follow a kinematic bicycle model
+* driven by the last steering command, skid steered vehicles keep their
+* measured yaw rate. The speed changes with the acceleration seen over a
+* small buffer of recent odometry. A prediction takes constant time.
+*
+* \date 10/17/2026
+*/
+#ifndef STATE_PREDICTOR_H
+#define STATE_PREDICTOR_H
+
+#include "avt_341/node/ros_types.h"
+
+namespace avt_341 {
+namespace control{
+
+class StatePredictor {
+public:
+	/// Create a predictor with no odometry
+	StatePredictor();
+
+	/**
+	* Set the wheelbase of the vehicle in meters
+	* \param wb Wheelbase to set
+	*/
+	void SetWheelbase(float wb) { wheelbase_ = wb; }
+
+	/**
+	* Set the max steering angle of the vehicle in radians
+	* \param st Max steering angle
+	*/
+	void SetMaxSteering(float st) { max_steering_angle_ = st; }
+
+	/**
+	* Use the skid steered model instead of the bicycle model
+	* \param skid_steered True for a skid steered vehicle
+	*/
+	void IsSkidSteered(bool skid_steered) { skid_steered_ = skid_steered; }
+
+	/**
+	* Add an odometry message to the buffer. Messages older than the newest one
+	* are dropped, unstamped messages replace the newest one.
+	* \param odom The odometry
+	* \param stamp Time of the odometry in seconds, 0 if unstamped
+	*/
+	void AddOdometry(const avt_341::msg::Odometry &odom, double stamp);
+
+	/**
+	* Set the steering command applied from now on, normalized to [-1,1] like the
+	* output of the pure pursuit controller. Ignored by the skid steered model.
+	* \param steering The normalized steering command
+	*/
+	void SetSteeringCommand(float steering) { steering_ = steering; }
+
+	/// Check if any odometry was added
+	bool HasOdometry() const { return count_ > 0; }
+
+	/// Get the time of the newest odometry in seconds
+	double GetLatestStamp() const { return stamps_[newest_]; }
+
+	/**
+	* Predict the state of the vehicle
+	* \param dt Time after the newest odometry in seconds
+	* \return The newest odometry moved forward by dt
+	*/
+	avt_341::msg::Odometry Predict(double dt) const;
+
+private:
+	static const int buffer_size_ = 10;
+	avt_341::msg::Odometry buffer_[buffer_size_];
+	double stamps_[buffer_size_];
+	float speeds_[buffer_size_];
+	int newest_;
+	int count_;
+
+	bool skid_steered_;
+	float wheelbase_;
+	float max_steering_angle_;
+	float steering_;
+};
+
+} // namespace control
+} // namespace avt_341
+
+#endif
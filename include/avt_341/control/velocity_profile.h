@@ -0,0 +1,62 @@
+/**
+* \class VelocityProfile
+*
+* Target speed at each point of a path, computed once per path.
+* The speed at each point is limited by the lateral acceleration allowed by
+* the path curvature there, and then by forward and backward passes so the
+* vehicle only has to accelerate and brake within the given limits.
+*
+* \date 10/17/2026
+*/
+#ifndef VELOCITY_PROFILE_H
+#define VELOCITY_PROFILE_H
+
+#include <vector>
+#include "avt_341/node/ros_types.h"
+
+namespace avt_341 {
+namespace control{
+
+class VelocityProfile {
+public:
+	/// Create an empty profile
+	VelocityProfile();
+
+	/**
+	* Set the limits of the profile
+	* \param max_speed Largest speed anywhere on the path in m/s
+	* \param max_lateral_g Largest lateral acceleration in units of 9.806 m/s^2
+	* \param max_accel Largest longitudinal acceleration in m/s^2
+	* \param max_decel Largest longitudinal deceleration in m/s^2
+	*/
+	void SetLimits(float max_speed, float max_lateral_g, float max_accel, float max_decel);
+
+	/**
+	* Compute the profile of a path
+	* \param path The path
+	*/
+	void Compute(const avt_341::msg::Path &path);
+
+	/**
+	* Get the target speed at a point of the path
+	* \param index The point, clamped to the path
+	* \return The speed in m/s, the maximum speed if the path is empty
+	*/
+	float GetSpeed(int index) const;
+
+	/// Get the number of points of the profile
+	int Size() const { return (int)speed_.size(); }
+
+private:
+	float max_speed_;
+	float max_lateral_g_;
+	float max_accel_;
+	float max_decel_;
+	std::vector<float> speed_;
+	std::vector<float> ds_;
+};
+
+} // namespace control
+} // namespace avt_341
+
+#endif
@@ -68,6 +68,10 @@ namespace avt_341 {
           header.seq = seq;
         }
 
+        inline unsigned int get_seq(const std_msgs::Header & header){
+          return header.seq;
+        }
+
         inline bool ok() {
             return ros::ok();
         }
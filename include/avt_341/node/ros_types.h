@@ -30,6 +30,8 @@
 #include "std_msgs/Int32.h"
 #include "std_msgs/Float64MultiArray.h"
 
+#include "diagnostic_msgs/DiagnosticArray.h"
+
 namespace avt_341 {
     namespace msg {
         using PointCloud = sensor_msgs::PointCloud;
@@ -64,6 +66,7 @@ namespace avt_341 {
 
         using OccupancyGrid = nav_msgs::OccupancyGrid;
         using OccupancyGridPtr = const nav_msgs::OccupancyGrid::ConstPtr &;
+        using OccupancyGridConstPtr = nav_msgs::OccupancyGrid::ConstPtr;
 
         using Path = nav_msgs::Path;
         using PathPtr = const nav_msgs::Path::ConstPtr &;
@@ -85,6 +88,12 @@ namespace avt_341 {
 
         using Int32 = std_msgs::Int32;
         using Int32Ptr = const std_msgs::Int32::ConstPtr &;
+
+        using DiagnosticArray = diagnostic_msgs::DiagnosticArray;
+        using DiagnosticArrayPtr = const diagnostic_msgs::DiagnosticArray::ConstPtr &;
+
+        using DiagnosticStatus = diagnostic_msgs::DiagnosticStatus;
+        using KeyValue = diagnostic_msgs::KeyValue;
     }
     namespace msg_tf{
         using Matrix3x3 = tf::Matrix3x3;
@@ -0,0 +1,23 @@
+/**
+ * \file allocation_counter.h
+ *
+ * Counts the heap allocations of the process, for the offline benchmark.
+ * Linking allocation_counter.cpp replaces the global operator new and
+ * operator delete, in all their plain, array and sized forms, so it must
+ * only be linked into executables that want the count.
+ *
+ * \date 10/17/2026
+ */
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+namespace avt_341 {
+namespace planning{
+
+/// Get the number of calls to operator new since the start of the process.
+unsigned long GetNumAllocations();
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
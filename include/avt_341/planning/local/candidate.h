@@ -11,6 +11,8 @@
 #ifndef SPLINE_CANDIDATE_H
 #define SPLINE_CANDIDATE_H
 #include <vector>
+#include <limits>
+#include <algorithm>
 #include "avt_341/planning/local/polynomial.h"
 
 namespace avt_341 {
@@ -45,6 +47,7 @@ public:
 		max_curvature_ = 0.0f;
 		max_length_ = 100.0f;
 		s0_ = 0.0f;
+		curve_end_ = std::numeric_limits<float>::max();
 	}
 
 	/**
@@ -65,25 +68,26 @@ public:
 		max_length_ = c.max_length_;
 		max_curvature_ = c.max_curvature_;
 		s0_ = c.s0_;
+		curve_end_ = c.curve_end_;
 	}
 
 	/**
 	 * Get the signed rho value of the candidate path at arc length s.
 	 * \param s The arc length along the path.
 	 */ 
-	float At(float s) { return curve_.At(s); }
+	float At(float s) const { return curve_.At(std::min(s, curve_end_)); }
 
 	/**
 	 * Get the signed rho value of the first derivative of the candidate path at arc length s.
 	 * \param s The arc length along the path.
 	 */ 
-	float DerivativeAt(float s) { return first_deriv_.At(s); }
+	float DerivativeAt(float s) const { return s < curve_end_ ? first_deriv_.At(s) : 0.0f; }
 
 	/**
 	 * Get the signed rho value of the second derivative of the candidate path at arc length s.
 	 * \param s The arc length along the path.
 	 */ 
-	float SecondDerivativeAt(float s) { return second_deriv_.At(s); }
+	float SecondDerivativeAt(float s) const { return s < curve_end_ ? second_deriv_.At(s) : 0.0f; }
 
 	/**
 	 * Return true if the candidate goes out of bounds.
@@ -195,6 +199,18 @@ public:
 	 */ 
 	float GetMaxLength() { return max_length_; }
 
+	/**
+	 * Set the arc length where the cubic ends. Past it the path holds
+	 * its final offset, parallel to the centerline.
+	 * \param s_end Arc length of the end of the cubic.
+	 */
+	void SetCurveEnd(float s_end) { curve_end_ = s_end; }
+
+	/**
+	 * Get the arc length where the cubic ends.
+	 */
+	float GetCurveEnd() const { return curve_end_; }
+
 	/**
 	 * Set the initial s-value of the path, with respect to the centerline s.
 	 * \param s0 The initial s-value of the path.
@@ -231,6 +247,7 @@ private:
 	float max_curvature_;
 	float max_length_;
 	float s0_;
+	float curve_end_;
 	int rank_;
 };
 
@@ -238,4 +255,4 @@ private:
 } // namespace avt_341
 
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
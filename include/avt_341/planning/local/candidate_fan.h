@@ -0,0 +1,202 @@
+/**
+ * \class CandidateFan
+ *
+ * Structure-of-arrays copy of the cubic coefficients of every candidate path.
+ * All candidates are sampled at the same arc lengths, so storing the
+ * coefficients contiguously lets the per-sample evaluation run over
+ * the whole fan in flat, branch free loops.
+ *
+ * rho(s) = a*s^3 + b*s^2 + c*s + d for s < e, and rho(e) beyond the
+ * curve end e of the candidate.
+ *
+ * \date 10/17/2026
+ */
+#ifndef SPLINE_CANDIDATE_FAN_H
+#define SPLINE_CANDIDATE_FAN_H
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace avt_341 {
+namespace planning{
+
+class CandidateFan {
+public:
+	/**
+	 * Create an empty fan.
+	 */
+	CandidateFan() {
+		min_end_ = std::numeric_limits<float>::max();
+	}
+
+	/**
+	 * Remove all candidates from the fan, keeping the allocated memory.
+	 */
+	void Clear() {
+		a_.clear();
+		b_.clear();
+		c_.clear();
+		d_.clear();
+		e_.clear();
+		min_end_ = std::numeric_limits<float>::max();
+	}
+
+	/**
+	 * Add a candidate to the fan.
+	 * \param coeffs Cubic coefficients ordered {a, b, c, d}, as returned by Planner::CalcCoeffs.
+	 * \param curve_end Arc length where the cubic ends, the candidate holds its offset after it.
+	 */
+	void Add(const std::vector<float> &coeffs, float curve_end = std::numeric_limits<float>::max()) {
+		a_.push_back(coeffs[0]);
+		b_.push_back(coeffs[1]);
+		c_.push_back(coeffs[2]);
+		d_.push_back(coeffs[3]);
+		e_.push_back(curve_end);
+		min_end_ = std::min(min_end_, curve_end);
+	}
+
+	/**
+	 * Get the number of candidates in the fan.
+	 */
+	int Size() const { return (int)a_.size(); }
+
+	/**
+	 * Evaluate rho and its first two derivatives of every candidate at arc length s.
+	 * Output arrays must hold at least Size() elements.
+	 * \param s The arc length along the candidates.
+	 * \param rho Output offsets.
+	 * \param drho Output first derivatives.
+	 * \param d2rho Output second derivatives.
+	 * \param first Index of the first candidate to evaluate, earlier outputs are left untouched.
+	 * \param last One past the index of the last candidate to evaluate, -1 for all of them.
+	 */
+	void Evaluate(float s, float *rho, float *drho, float *d2rho, int first = 0, int last = -1) const {
+		const int n = last < 0 ? Size() : last;
+		const float *a = a_.data();
+		const float *b = b_.data();
+		const float *c = c_.data();
+		const float *d = d_.data();
+		const float *e = e_.data();
+		// each loop writes a single output, which keeps the run-time alias
+		// checks few enough for the loops to be vectorized
+		if (s < min_end_) {
+			// before the end of every curve, no candidate is clamped
+			const float s2 = s * s;
+			const float s3 = s2 * s;
+			for (int i = first; i < n; i++) rho[i] = a[i] * s3 + b[i] * s2 + c[i] * s + d[i];
+			for (int i = first; i < n; i++) drho[i] = 3.0f * a[i] * s2 + 2.0f * b[i] * s + c[i];
+			for (int i = first; i < n; i++) d2rho[i] = 6.0f * a[i] * s + 2.0f * b[i];
+			return;
+		}
+		for (int i = first; i < n; i++) {
+			const float si = std::min(s, e[i]);
+			const float s2 = si * si;
+			const float s3 = s2 * si;
+			rho[i] = a[i] * s3 + b[i] * s2 + c[i] * si + d[i];
+		}
+		for (int i = first; i < n; i++) {
+			const float si = std::min(s, e[i]);
+			const float on = s < e[i] ? 1.0f : 0.0f;
+			const float s2 = si * si;
+			drho[i] = (3.0f * a[i] * s2 + 2.0f * b[i] * si + c[i]) * on;
+		}
+		for (int i = first; i < n; i++) {
+			const float si = std::min(s, e[i]);
+			const float on = s < e[i] ? 1.0f : 0.0f;
+			d2rho[i] = (6.0f * a[i] * si + 2.0f * b[i]) * on;
+		}
+	}
+
+	/**
+	 * Evaluate only rho of every candidate at arc length s.
+	 * \param s The arc length along the candidates.
+	 * \param rho Output offsets, at least Size() elements.
+	 */
+	void EvaluateRho(float s, float *rho) const {
+		const int n = Size();
+		const float *a = a_.data();
+		const float *b = b_.data();
+		const float *c = c_.data();
+		const float *d = d_.data();
+		const float *e = e_.data();
+		for (int i = 0; i < n; i++) {
+			const float si = std::min(s, e[i]);
+			const float s2 = si * si;
+			const float s3 = s2 * si;
+			rho[i] = a[i] * s3 + b[i] * s2 + c[i] * si + d[i];
+		}
+	}
+
+	/**
+	 * Evaluate rho of one candidate at arc length s.
+	 * \param i Index of the candidate.
+	 * \param s The arc length along the candidate.
+	 */
+	float Rho(int i, float s) const {
+		s = std::min(s, e_[i]);
+		const float s2 = s * s;
+		const float s3 = s2 * s;
+		return a_[i] * s3 + b_[i] * s2 + c_[i] * s + d_[i];
+	}
+
+	/**
+	 * Evaluate drho/ds of one candidate at arc length s.
+	 * \param i Index of the candidate.
+	 * \param s The arc length along the candidate.
+	 */
+	float Slope(int i, float s) const {
+		if (s >= e_[i]) return 0.0f;
+		return 3.0f * a_[i] * s * s + 2.0f * b_[i] * s + c_[i];
+	}
+
+	/**
+	 * Get the largest |rho| of one candidate over an interval of arc length.
+	 * The extremes of a cubic are at the interval ends or at the roots of its derivative.
+	 * \param i Index of the candidate.
+	 * \param s0 Start of the interval.
+	 * \param s1 End of the interval.
+	 */
+	float MaxAbsRho(int i, float s0, float s1) const {
+		float a = a_[i];
+		float b = b_[i];
+		float c = c_[i];
+		float d = d_[i];
+		s0 = std::min(s0, e_[i]);
+		s1 = std::min(s1, e_[i]);
+		float m = std::max(fabsf(((a*s0 + b)*s0 + c)*s0 + d), fabsf(((a*s1 + b)*s1 + c)*s1 + d));
+		// roots of 3a*s^2 + 2b*s + c
+		float roots[2];
+		int nroots = 0;
+		if (fabsf(a) > 1.0E-12f) {
+			float disc = b*b - 3.0f*a*c;
+			if (disc >= 0.0f) {
+				float sq = sqrtf(disc);
+				roots[nroots++] = (-b + sq) / (3.0f*a);
+				roots[nroots++] = (-b - sq) / (3.0f*a);
+			}
+		}
+		else if (fabsf(b) > 1.0E-12f) {
+			roots[nroots++] = -c / (2.0f*b);
+		}
+		for (int k = 0; k < nroots; k++) {
+			float s = roots[k];
+			if (s > s0 && s < s1) m = std::max(m, fabsf(((a*s + b)*s + c)*s + d));
+		}
+		return m;
+	}
+
+private:
+	std::vector<float> a_;
+	std::vector<float> b_;
+	std::vector<float> c_;
+	std::vector<float> d_;
+	std::vector<float> e_;
+	// smallest curve end, the clamp is skipped before it
+	float min_end_;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * \class CandidateTemplateCache
+ *
+ * Least recently used cache of candidate sample tables.
+ * The shape of every candidate in the Frenet frame depends only on the
+ * start conditions and the lattice, so the offset rho and its derivatives
+ * at each arc length sample can be reused by later cycles that start from
+ * the same quantized offset and heading, together with the candidates
+ * themselves, their end offsets and their largest offsets. A hit leaves
+ * only the mapping to Cartesian coordinates and the grid lookups to do
+ * each cycle.
+ *
+ * \date 10/17/2026
+ */
+#ifndef SPLINE_CANDIDATE_TEMPLATE_CACHE_H
+#define SPLINE_CANDIDATE_TEMPLATE_CACHE_H
+#include <vector>
+#include <list>
+#include <iterator>
+#include "avt_341/planning/local/candidate.h"
+
+namespace avt_341 {
+namespace planning{
+
+/// Start conditions and lattice a template was generated for.
+struct CandidateTemplateKey {
+	int rho_start;
+	int theta_start;
+	float s_end;
+	float lane_width;
+	int num_offsets;
+	int num_horizons;
+	float ds;
+	float s_check;
+
+	bool operator == (const CandidateTemplateKey &k) const {
+		return rho_start == k.rho_start && theta_start == k.theta_start && s_end == k.s_end &&
+			lane_width == k.lane_width && num_offsets == k.num_offsets && num_horizons == k.num_horizons && ds == k.ds &&
+			s_check == k.s_check;
+	}
+};
+
+/// Offsets and derivatives of every lattice point at every sample,
+/// sample k of lattice point p is element k*num_points + p.
+struct CandidateTemplate {
+	CandidateTemplateKey key;
+	int num_points;
+	int num_samples;
+	std::vector<float> rho;
+	std::vector<float> drho;
+	std::vector<float> d2rho;
+	/// candidate of each lattice point, without its start arc length and costs
+	std::vector<Candidate> candidates;
+	/// offset of each lattice point at the end of the look ahead
+	std::vector<float> rho_end;
+	/// largest absolute offset of each lattice point from s_check to the end of the look ahead
+	std::vector<float> max_abs_rho;
+};
+
+class CandidateTemplateCache {
+public:
+	/**
+	 * Create an empty cache.
+	 */
+	CandidateTemplateCache() { capacity_ = 0; }
+
+	/**
+	 * Set the maximum number of templates kept, 0 disables the cache.
+	 * \param capacity Number of templates.
+	 */
+	void SetCapacity(int capacity) {
+		capacity_ = capacity < 0 ? 0 : capacity;
+		while ((int)templates_.size() > capacity_) templates_.pop_back();
+	}
+
+	/**
+	 * Check if the cache is enabled.
+	 */
+	bool Enabled() const { return capacity_ > 0; }
+
+	/**
+	 * Find the template of a key and mark it as the most recently used.
+	 * \param key Start conditions and lattice.
+	 * \return The template, or null if it is not cached.
+	 */
+	const CandidateTemplate *Find(const CandidateTemplateKey &key) {
+		for (std::list<CandidateTemplate>::iterator it = templates_.begin(); it != templates_.end(); ++it) {
+			if (it->key == key) {
+				templates_.splice(templates_.begin(), templates_, it);
+				return &templates_.front();
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Add a template for a key, evicting the least recently used one if the cache is full.
+	 * The evicted template's memory is reused, so earlier pointers from Find are invalidated.
+	 * \param key Start conditions and lattice.
+	 * \return The new template with its tables left for the caller to fill.
+	 */
+	CandidateTemplate &Insert(const CandidateTemplateKey &key) {
+		if ((int)templates_.size() < capacity_) templates_.push_front(CandidateTemplate());
+		else templates_.splice(templates_.begin(), templates_, std::prev(templates_.end()));
+		CandidateTemplate &t = templates_.front();
+		t.key = key;
+		return t;
+	}
+
+private:
+	std::list<CandidateTemplate> templates_;
+	int capacity_;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * \class DynamicObstacleMap
+ *
+ * Moving obstacles predicted with constant velocity over a time horizon,
+ * stored in a spatial hash with one layer per time slice. Each obstacle is
+ * inserted in the cells its inflated disk sweeps during a slice, so a
+ * query only tests the obstacles that can be within the influence distance
+ * of the query point at the query time.
+ *
+ * \date 10/17/2026
+ */
+#ifndef DYNAMIC_OBSTACLE_MAP_H
+#define DYNAMIC_OBSTACLE_MAP_H
+
+#include <vector>
+
+namespace avt_341 {
+namespace planning{
+
+/// Tracked moving obstacle in local ENU, position at the planning time.
+struct DynamicObstacle {
+	float x;
+	float y;
+	float vx;
+	float vy;
+	float radius;
+};
+
+class DynamicObstacleMap {
+public:
+	/**
+	 * Create an empty map.
+	 */
+	DynamicObstacleMap();
+
+	/**
+	 * Set the obstacles. The hash is rebuilt by the next call to Build.
+	 * \param obstacles List of obstacles.
+	 */
+	void SetObstacles(const std::vector<DynamicObstacle> &obstacles);
+
+	/**
+	 * Hash the predicted obstacles.
+	 * \param influence Distance from an obstacle's edge within which queries must find it, meters.
+	 * \param horizon Time horizon of the prediction, seconds.
+	 * \param slice_dt Duration of a time slice, seconds.
+	 * \param cell_size Size of the hash cells, meters.
+	 */
+	void Build(float influence, float horizon, float slice_dt, float cell_size);
+
+	/**
+	 * Check if there are no obstacles.
+	 */
+	bool Empty() const { return obstacles_.empty(); }
+
+	/**
+	 * Get the time horizon of the last Build.
+	 */
+	float GetHorizon() const { return horizon_; }
+
+	/**
+	 * Get the largest obstacle speed, meters per second.
+	 */
+	float GetMaxSpeed() const { return max_speed_; }
+
+	/**
+	 * Get the distance from a point to the edge of the nearest obstacle at a given time.
+	 * Distances up to the influence distance are exact, larger ones are reported as
+	 * the influence distance, so the result is always a lower bound of the distance.
+	 * \param x The x-coordinate in local ENU.
+	 * \param y The y-coordinate in local ENU.
+	 * \param t Time from now, seconds, clamped to the horizon.
+	 * \return The distance, negative inside an obstacle, or a large value before Build.
+	 */
+	float Distance(float x, float y, float t) const;
+
+private:
+	int Bucket(int ix, int iy, int slice) const;
+
+	std::vector<DynamicObstacle> obstacles_;
+	float influence_;
+	float horizon_;
+	float slice_dt_;
+	float cell_size_;
+	float max_speed_;
+	int num_slices_;
+	// bucket b lists obstacles entries_[start_[b]] to entries_[start_[b+1]-1]
+	std::vector<int> start_;
+	std::vector<int> entries_;
+	int bucket_mask_;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * \class GridView
+ *
+ * Non-owning view of occupancy grid data and its geometry.
+ * The data can belong to a received grid message or to a
+ * scratch buffer owned by the planner, so the planner can
+ * work on grids without copying them.
+ * Cells are stored like the grid messages of this package:
+ * cell (ix, iy) is data[ix*height + iy].
+ * A rectangular window of cells can be overridden by a second
+ * buffer, so a grid that is only modified inside a window, like a
+ * dilated grid, does not need a full copy. Cells should be read
+ * with At, which picks the buffer holding the cell.
+ *
+ * \date 10/17/2026
+ */
+#ifndef SPLINE_GRID_VIEW_H
+#define SPLINE_GRID_VIEW_H
+
+#include <cstdint>
+#include "avt_341/node/ros_types.h"
+
+namespace avt_341 {
+namespace planning{
+
+struct GridView {
+	/**
+	 * Create an empty view.
+	 */
+	GridView() {
+		data = nullptr;
+		width = 0;
+		height = 0;
+		resolution = 1.0f;
+		origin_x = 0.0f;
+		origin_y = 0.0f;
+		ClearWindow();
+	}
+
+	/**
+	 * Create a view of a grid message.
+	 * \param grid The grid that provides the geometry.
+	 * \param grid_data The cell values, width*height elements laid out like grid.data.
+	 */
+	GridView(const avt_341::msg::OccupancyGrid &grid, const int8_t *grid_data) {
+		data = grid_data;
+		width = (int)grid.info.width;
+		height = (int)grid.info.height;
+		resolution = grid.info.resolution;
+		origin_x = (float)grid.info.origin.position.x;
+		origin_y = (float)grid.info.origin.position.y;
+		ClearWindow();
+	}
+
+	/**
+	 * Read the cells of a window from another buffer.
+	 * \param window_data The cells x0 <= ix < x1, y0 <= iy < y1, cell (ix, iy) is window_data[(ix-x0)*(y1-y0) + iy-y0].
+	 */
+	void SetWindow(const int8_t *window_data, int x0, int y0, int x1, int y1) {
+		win_data = window_data;
+		win_x0 = x0;
+		win_y0 = y0;
+		win_x1 = x1;
+		win_y1 = y1;
+	}
+
+	/**
+	 * Read all cells from data.
+	 */
+	void ClearWindow() {
+		SetWindow(nullptr, 0, 0, 0, 0);
+	}
+
+	/**
+	 * Return the value of a cell inside the grid.
+	 */
+	int8_t At(int ix, int iy) const {
+		if (ix >= win_x0 && ix < win_x1 && iy >= win_y0 && iy < win_y1) {
+			return win_data[(ix - win_x0) * (win_y1 - win_y0) + iy - win_y0];
+		}
+		return data[ix * height + iy];
+	}
+
+	/**
+	 * Return true if the view does not reference any cells.
+	 */
+	bool Empty() const { return data == nullptr || width <= 0 || height <= 0; }
+
+	/**
+	 * Return the number of cells in the grid.
+	 */
+	int Size() const { return width * height; }
+
+	const int8_t *data;
+	int width;
+	int height;
+	float resolution;
+	float origin_x;
+	float origin_y;
+	// overriding window, empty when x0 == x1
+	const int8_t *win_data;
+	int win_x0;
+	int win_y0;
+	int win_x1;
+	int win_y1;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
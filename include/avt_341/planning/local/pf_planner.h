@@ -12,6 +12,17 @@
  *
  * Modified by CTG to be faster, integrate with ROS, and work with an Occupancy grid.
  *
+ * The repulsive potential of the obstacles, the sum of eta/(d^2+0.1) over
+ * the occupied cells within the cutoff distance, is kept as a map of the
+ * grid's cells that the descent reads with bilinear interpolation. A cell is
+ * computed the first time it is read, from the obstacles of the neighbouring
+ * buckets of a uniform grid with buckets as large as the cutoff distance.
+ *
+ * The descent either takes the best of 8 neighbouring steps, or follows the
+ * gradient of the interpolated field with an adaptive step. The gradient
+ * descent detects local minima, and leaves them along a wavefront
+ * (navigation function) from the goal computed on the same grid.
+ *
  * \author Chris Goodin
  *
  * \date 1/19/2022
@@ -34,11 +45,16 @@ public:
 	PfPlanner();
 
 	/**
-	 * Calculate a list of candidate costs given an occupancy grid and vehicle odometry.
+	 * Set the occupancy grid. The repulsive potential map is rebuilt by the next call to Plan.
 	 * \param grid ROS occupancy grid.
+	 */
+	void SetGrid(const avt_341::msg::OccupancyGrid &grid);
+
+	/**
+	 * Plan a path from the vehicle to the goal through the last grid set.
 	 * \param odom ROS odometry of the current vehicle.
 	 */ 
-	avt_341::msg::Path Plan(avt_341::msg::OccupancyGrid grid, avt_341::msg::Odometry odom);
+	avt_341::msg::Path Plan(const avt_341::msg::Odometry &odom);
 
 	/**
 	 * Set the goal point in the local ENU coordinate frame
@@ -46,30 +62,70 @@ public:
 	void SetGoal(float gx, float gy);
 
 	/// Set the Eta parameter
-	void SetEta(float eta){eta_ = eta;}
+	void SetEta(float eta){eta_ = eta; map_valid_ = false;}
 
 	/// Set the Kp parameter
 	void SetKp(float kp){kp_ = kp;}
 
 	/// Set the cutoff distance
-	void SetCutoffDistance(float cutoff_dist){ obs_cutoff_dist_ = cutoff_dist; }
+	void SetCutoffDistance(float cutoff_dist){ obs_cutoff_dist_ = cutoff_dist; map_valid_ = false; }
+
+	/// Follow the gradient of the field instead of taking 8-neighbour steps
+	void SetUseGradientDescent(bool use_gradient){ use_gradient_ = use_gradient; }
 
 private:
 	float Hypot(float x, float y);
     
 	float CalcAttractivePotential(float x, float y, float gx, float gy);
 
-	float CalcRepulsivePotential(float x, float y, std::vector<float> ox, std::vector<float> oy);
+	void IndexObstacles();
+
+	float CellPotential(int i, int j);
+
+	float CalcRepulsivePotential(float x, float y, float *grad_x = nullptr, float *grad_y = nullptr);
 
 	std::vector<std::vector<float> > GetMotionModel(float step);
 
-	void PotentialFieldPlanning(float minx, float miny, float reso, float sx, float sy, float gx, float gy, std::vector<float> ox, std::vector<float> oy);
+	void PotentialFieldPlanning(float sx, float sy, float gx, float gy);
+
+	void GradientDescentPlanning(float sx, float sy, float gx, float gy);
+
+	void ComputeWavefront(float gx, float gy);
+
+	int FollowWavefront(float &xp, float &yp, float gx, float gy, float max_potential, int max_cells);
 
 	float goal_x_;
 	float goal_y_;
 	float kp_;
 	float eta_;
 	float obs_cutoff_dist_;
+	// grid geometry, cells are column-major like the occupancy grid
+	int width_;
+	int height_;
+	float minx_;
+	float miny_;
+	float reso_;
+	// cell indices of the occupied cells of the grid
+	std::vector<int> obstacle_cells_;
+	// occupied cell centers by bucket, bucket b holds entries bucket_start_[b] to bucket_start_[b+1]-1,
+	// buckets are column-major like the grid
+	float bucket_size_;
+	int bucket_nx_;
+	int bucket_ny_;
+	std::vector<int> bucket_start_;
+	std::vector<float> bucket_x_;
+	std::vector<float> bucket_y_;
+	// repulsive potential at the cell centers, valid where map_ready_ is set
+	std::vector<float> repulsive_map_;
+	std::vector<unsigned char> map_ready_;
+	// occupied cells of the grid and wavefront distance to the goal, in cells
+	std::vector<unsigned char> occupied_;
+	std::vector<float> wavefront_;
+	int wavefront_gi_;
+	int wavefront_gj_;
+	bool wavefront_valid_;
+	bool use_gradient_;
+	bool map_valid_;
 	std::vector<float> rx_;
 	std::vector<float> ry_;
 };
@@ -0,0 +1,57 @@
+/**
+ * \class PlannerInput
+ *
+ * Inputs of one local planner cycle, recorded by the planner node and
+ * replayed by the offline benchmark. The recording is a plain text file
+ * with one block per cycle, so it can be read without ROS running.
+ * A grid is only written in the cycle it was received, later cycles
+ * refer to it, so recordings of long runs stay small.
+ *
+ * \date 10/17/2026
+ */
+#ifndef PLANNER_RECORDING_H
+#define PLANNER_RECORDING_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include "avt_341/node/ros_types.h"
+
+namespace avt_341 {
+namespace planning{
+
+/// Grid, segmentation grid, odometry and source path of one cycle.
+struct PlannerInput {
+	PlannerInput() { new_grid = true; new_segmentation_grid = true; }
+
+	// a grid is only set when it is new, otherwise the grid of the previous cycle applies
+	bool new_grid;
+	avt_341::msg::OccupancyGrid grid;
+	// empty data if no segmentation grid was received
+	bool new_segmentation_grid;
+	avt_341::msg::OccupancyGrid segmentation_grid;
+	avt_341::msg::Odometry odom;
+	avt_341::msg::Path path;
+};
+
+/**
+ * Append the inputs of a cycle to a recording.
+ * \param out The recording stream.
+ * \param input The inputs of the cycle.
+ * \return False if the stream failed.
+ */
+bool WritePlannerInput(std::ostream &out, const PlannerInput &input);
+
+/**
+ * Read all the cycles of a recording.
+ * Grids are only set in the cycles that received them, like they were written.
+ * \param fname The recording file.
+ * \param inputs The cycles read, in the recorded order.
+ * \return False if the file could not be opened or a block is malformed.
+ */
+bool ReadPlannerInputs(const std::string &fname, std::vector<PlannerInput> &inputs);
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
@@ -37,8 +37,10 @@ public:
 	 * Get a polynomial representing the derivative of the current polynomial. 
 	 */
 	Polynomial Derivative() {
+		// coeffs_ is stored lowest order first, but the constructor
+		// expects the highest order first
 		std::vector<float> coeffs;
-		for (int i = 0; i < coeffs_.size(); i++) {
+		for (int i = (int)coeffs_.size() - 1; i > 0; i--) {
 			float c = i * coeffs_[i];
 			coeffs.push_back(c);
 		}
@@ -50,7 +52,7 @@ public:
 	 * Get the value of the polynomial at x
 	 * \param x Evaluate the polynomial at p(x)
 	 */ 
-	float At(float x) {
+	float At(float x) const {
 		float y = 0.0f;
 		for (int i = 0; i < coeffs_.size(); i++) {
 
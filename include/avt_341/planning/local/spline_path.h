@@ -21,6 +21,7 @@ namespace planning{
 struct SegmentInfo {
 	utils::vec2 point;
 	int id;
+	float offset;
 };
 
 /// Distance from a point to a segment, and the closest point on the segment.
@@ -29,6 +30,12 @@ struct PointSegDist {
 	float dist;
 };
 
+/// Point on the path and the unit tangent of the segment containing it.
+struct PathFrame {
+	utils::vec2 point;
+	utils::vec2 tangent;
+};
+
 /// Curvature and tangent angle of the path.
 struct CurveInfo {
 	float curvature;
@@ -84,8 +91,27 @@ public:
 	 */
 	utils::vec2 ToCartesian(float s, float rho);
 
+	/**
+	 * Get the point on the path at arc length s and the tangent of its segment.
+	 * A point offset by rho is then point + (-tangent.y, tangent.x)*rho.
+	 * \param s The arc length parameter.
+	 */
+	PathFrame GetFrameAt(float s);
+
+	/**
+	 * Get the point and tangent at arc length s, starting the segment search from a cursor.
+	 * For increasing s the cursor advances in amortized constant time, otherwise
+	 * the segment is found by binary search. Initialize the cursor to -1.
+	 * \param s The arc length parameter.
+	 * \param cursor Segment index of the previous query, updated to the segment of s.
+	 */
+	PathFrame GetFrameAt(float s, int &cursor);
+
 	/**
 	 * Convert a point from Cartesian coordinates to the s-rho system.
+	 * The search starts from the segment of the previous call and only
+	 * looks at nearby segments, falling back to a grid hash of the
+	 * segments when the point is not close to the previous solution.
 	 * \param x The x-coordinate in local ENU.
 	 * \param y The y-coordinate in local ENU.
 	 */ 
@@ -97,6 +123,13 @@ public:
 	 */ 
 	CurveInfo GetCurvatureAndAngle(float s);
 
+	/**
+	 * Get the curvature and tangent angle at arc length s, starting the segment search from a cursor.
+	 * \param s The arc length and which to measure the curvature.
+	 * \param cursor Segment index of the previous query, updated to the segment of s. Initialize to -1.
+	 */
+	CurveInfo GetCurvatureAndAngle(float s, int &cursor);
+
 	/**
 	 * Get the last point on the path. 
 	 */
@@ -127,6 +160,13 @@ public:
 	 */
 	float GetTheta(float s);
 
+	/**
+	 * Get the angle from X at a given path length, starting the segment search from a cursor.
+	 * \param s The arc length along the path at which to find the angle.
+	 * \param cursor Segment index of the previous query, updated to the segment of s. Initialize to -1.
+	 */
+	float GetTheta(float s, int &cursor);
+
 	void FixBeginning(float x, float y);
 
 private:
@@ -135,14 +175,40 @@ private:
 	std::vector<float> theta_;
 	std::vector<float> arc_length_;
 	std::vector<float> discrete_lengths_;
+	// unit tangent and slopes of curvature and angle along each segment
+	std::vector<utils::vec2> tangent_;
+	std::vector<float> curvature_slope_;
+	std::vector<float> theta_slope_;
 	float max_lookahead_;
 	void CalcAnglesAndCurvature();
 
+	// closest segment search for ToSRho
+	struct SRhoSearch {
+		int index;
+		float dist;
+		utils::vec2 point;
+	};
+	void BuildSegmentHash();
+	void TestSegment(int i, utils::vec2 tp, SRhoSearch &best);
+	bool FindClosestSegmentHashed(utils::vec2 tp, SRhoSearch &best);
+	int last_segment_;
+	// grid hash of the segments, cell c lists hash_segments_[hash_start_[c]] to hash_segments_[hash_start_[c+1]-1]
+	bool hash_built_;
+	float hash_cell_size_;
+	utils::vec2 hash_origin_;
+	int hash_nx_;
+	int hash_ny_;
+	std::vector<int> hash_start_;
+	std::vector<int> hash_segments_;
+
 	float MengerCurvature(utils::vec2 p0, utils::vec2 p1, utils::vec2 p2);
 	float TriangleArea(utils::vec2 a, utils::vec2 b, utils::vec2 c);
 
 	PointSegDist PointToSegmentDistance(utils::vec2 P, utils::vec2 Q, utils::vec2 X);
 	SegmentInfo FindSegment(float s);
+	SegmentInfo FindSegment(float s, int &cursor);
+	int SegmentIndex(float s) const;
+	SegmentInfo MakeSegmentInfo(int id, float s);
 
 };
 
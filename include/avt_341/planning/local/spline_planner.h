@@ -16,8 +16,17 @@
 #define SPLINE_PLANNER_H
 
 #include <vector>
+#include <memory>
+#include <functional>
 #include "avt_341/planning/local/spline_path.h"
 #include "avt_341/planning/local/candidate.h"
+#include "avt_341/planning/local/candidate_fan.h"
+#include "avt_341/planning/local/candidate_template_cache.h"
+#include "avt_341/planning/local/grid_view.h"
+#include "avt_341/planning/local/vehicle_footprint.h"
+#include "avt_341/planning/local/thread_pool.h"
+#include "avt_341/planning/local/dynamic_obstacle_map.h"
+#include "avt_341/planning/local/stage_timer.h"
 // ROS INCLUDES
 #include "avt_341/node/ros_types.h"
 
@@ -35,10 +44,15 @@ public:
 	 * Set the desired centerline for the planner.
 	 * \param path A tang_planner::Path object. 
 	 */
-	void SetCenterline(Path path) { path_ = path; }
+	void SetCenterline(Path path) {
+		path_ = path;
+		path_generation_++;
+	}
 
 	/**
 	 * Generate a set of candidate paths.
+	 * With more than one horizon, every end offset is generated for each horizon,
+	 * see SetNumHorizons, so there are npaths times the number of horizons candidates.
 	 * \param npaths The number of paths to generate.
 	 * \param s_start The arc length along the centerline at which to start.
 	 * \param rho_start The offset from the path in the initial configuration.
@@ -56,18 +70,47 @@ public:
 	std::vector<Candidate> GetCandidates() { return candidates_; }
 
 	/**
-	 * Calculate a list of candidate costs given an occupancy grid and vehicle odometry.
+	 * Set the occupancy grid used for the static safety cost.
+	 * The planner keeps a reference to the message instead of copying it.
 	 * \param grid ROS occupancy grid.
+	 */
+	void SetGrid(avt_341::msg::OccupancyGridConstPtr grid);
+
+	/**
+	 * Set the terrain segmentation grid. May be null if no segmentation is available.
+	 * \param grid ROS occupancy grid holding the segmentation cost of each cell.
+	 */
+	void SetSegmentationGrid(avt_341::msg::OccupancyGridConstPtr grid);
+
+	/**
+	 * Get the view of the occupancy grid used for planning, including the dilated window.
+	 */
+	const GridView &GetGrid() const { return grid_; }
+
+	/**
+	 * Get the view of the segmentation grid used for planning, including the dilated window.
+	 */
+	const GridView &GetSegmentationGrid() const { return segmentation_grid_; }
+
+	/**
+	 * Calculate a list of candidate costs given the current grids and vehicle odometry.
 	 * \param odom ROS odometry of the current vehicle.
 	 */ 
-	bool CalculateCandidateCosts(avt_341::msg::OccupancyGrid grid, avt_341::msg::OccupancyGrid segmentation_grid, avt_341::msg::Odometry odom);
+	bool CalculateCandidateCosts(const avt_341::msg::Odometry &odom);
+
+	/**
+	 * Dilate the occupancy grid set by SetGrid with a mask of given size.
+	 * Only the cells of the region are written, to a buffer owned by the planner,
+	 * and the received grid is left untouched.
+	 * \param x The dilation mask size is (2x+1)*(2x+1).
+	 */
+	void DilateGrid(int x, float llx, float lly, float urx, float ury);
 
 	/**
-	 * Dilate the map with a mask of given size.
-	 * \param grid The occupancy grid to dilate.
-	 * \param x The dilation mask size is (x+1)*(x+1).
+	 * Dilate the segmentation grid set by SetSegmentationGrid with a mask of given size.
+	 * \param x The dilation mask size is (2x+1)*(2x+1).
 	 */
-	void DilateGrid(avt_341::msg::OccupancyGrid &grid, int x, float llx, float lly, float urx, float ury);
+	void DilateSegmentationGrid(int x, float llx, float lly, float urx, float ury);
 
 	/**
 	 * Get a point along the optimal path at an arc length s_step from the current position. 
@@ -128,6 +171,153 @@ public:
 	 */ 
   	void SetUseBlend(bool use_blend){ use_blend_ = use_blend; }
 
+	/**
+	 * Set the distance from an obstacle at which a candidate counts as a collision.
+	 * Zero means only samples on an occupied cell collide, use half the vehicle
+	 * width to check the width of the vehicle around the candidate.
+	 * Default is 0.0
+	 * \param r The collision radius, meters.
+	 */
+	void SetCollisionRadius(float r) { collision_radius_ = r; }
+
+	/**
+	 * Set the clearance margin over which the static safety cost of a
+	 * collision-free candidate falls from 1 to 0. Zero keeps the static
+	 * safety binary.
+	 * Default is 0.0
+	 * \param d The clearance margin, meters.
+	 */
+	void SetClearanceCostDistance(float d) { clearance_cost_dist_ = d; }
+
+	/**
+	 * Set the size of the rectangular vehicle footprint checked for collisions
+	 * along each candidate, oriented with the candidate heading.
+	 * A length or width of zero disables the footprint check.
+	 * Default is disabled.
+	 * \param length Length of the vehicle, meters.
+	 * \param width Width of the vehicle, meters.
+	 */
+	void SetVehicleFootprint(float length, float width) { footprint_.SetSize(length, width); }
+
+	/**
+	 * Sets whether candidates are scored by branch and bound.
+	 * Candidates are scored in order of their cost without static safety,
+	 * which is a lower bound of the total cost, and the grid checks are skipped
+	 * for every candidate whose lower bound exceeds the best cost found.
+	 * The selected path is the same as with exhaustive scoring, but the costs
+	 * of skipped candidates are left at their lower bounds.
+	 * Default is true.
+	 * \param prune Whether to prune candidates.
+	 */
+	void SetUseCandidatePruning(bool prune) { prune_candidates_ = prune; }
+
+	/**
+	 * Enable coarse to fine sampling of the candidates.
+	 * GeneratePaths then only creates a coarse subset of the npaths end offsets, and
+	 * CalculateCandidateCosts refines it around the best few candidates and the
+	 * obstacle boundaries, halving the spacing each level down to the spacing of npaths.
+	 * Candidate pruning is not used in this mode.
+	 * Default is disabled.
+	 * \param coarse_paths Maximum number of candidates in the coarse fan, 0 disables adaptive sampling.
+	 * \param max_evaluations Maximum number of candidates evaluated per cycle, including the coarse fan.
+	 */
+	void SetAdaptiveSampling(int coarse_paths, int max_evaluations) {
+		adaptive_coarse_paths_ = coarse_paths;
+		adaptive_budget_ = max_evaluations;
+	}
+
+	/**
+	 * Set the number of horizons of the candidate lattice.
+	 * Each horizon is a row of candidates that reach their end offsets at a
+	 * different arc length, evenly spaced from half the look ahead distance to the full
+	 * look ahead distance, and hold the offset after it. Blending and adaptive sampling
+	 * operate within each row.
+	 * Default is 1, every candidate ends at the look ahead distance.
+	 * \param nh Number of horizons.
+	 */
+	void SetNumHorizons(int nh) { num_horizons_ = nh < 1 ? 1 : nh; }
+
+	/**
+	 * Set the number of threads used to score the candidates.
+	 * The per-sample centerline tables are shared by all threads and
+	 * the candidates are split into contiguous ranges.
+	 * Default is 1, everything runs on the calling thread.
+	 * \param nt Number of threads including the calling thread.
+	 */
+	void SetNumThreads(int nt);
+
+	/**
+	 * Enable caching of the candidate sample tables between cycles.
+	 * The start offset and heading passed to GeneratePaths are rounded to
+	 * the given quanta, so cycles that start from nearly the same conditions
+	 * reuse the offsets and derivatives of every candidate at every sample
+	 * instead of evaluating the polynomials again.
+	 * Default is disabled.
+	 * \param size Number of cached templates, 0 disables the cache.
+	 * \param rho_quantum Rounding step of the start offset, meters.
+	 * \param theta_quantum Rounding step of the start heading, radians.
+	 */
+	void SetTemplateCache(int size, float rho_quantum, float theta_quantum);
+
+	/**
+	 * Set the tracked moving obstacles used for the dynamic safety cost.
+	 * Positions are predicted with constant velocity, and each candidate is checked
+	 * against them at the time the vehicle would reach each sample at its current speed.
+	 * \param obstacles List of obstacles in local ENU, may be empty.
+	 */
+	void SetDynamicObstacles(const std::vector<DynamicObstacle> &obstacles) { dynamic_obstacles_.SetObstacles(obstacles); }
+
+	/**
+	 * Set the parameters of the dynamic safety cost.
+	 * The cost of a candidate is 1 if the vehicle disk touches a predicted obstacle and
+	 * falls to 0 over the cost distance, taking the worst sample of the candidate.
+	 * Defaults are a radius of 1.5 m, a cost distance of 2.0 m and a horizon of 5.0 s.
+	 * \param vehicle_radius Radius of the disk around the vehicle checked against the obstacles, meters.
+	 * \param cost_dist Distance over which the cost falls from 1 to 0, meters.
+	 * \param time_horizon Samples reached later than this are not checked, seconds.
+	 */
+	void SetDynamicObstacleParams(float vehicle_radius, float cost_dist, float time_horizon) {
+		dynamic_radius_ = vehicle_radius;
+		dynamic_cost_dist_ = cost_dist;
+		dynamic_horizon_ = time_horizon;
+	}
+
+	/**
+	 * Set the stride of the coarse samples of the dynamic safety check.
+	 * The samples between two coarse samples are only checked when an obstacle
+	 * can get within the cost distance of them, assuming the candidate is close
+	 * to straight between coarse samples. This matches checking every sample for
+	 * smooth candidates but is not guaranteed. Default is 4, 1 checks every sample.
+	 * \param stride Number of samples between coarse samples.
+	 */
+	void SetDynamicSafetyStride(int stride) { dynamic_stride_ = stride < 1 ? 1 : stride; }
+
+	/**
+	 * Enable reuse of the grid checks of the previous cycles.
+	 * While the grids and the centerline are unchanged, the lattice is the same and the
+	 * start has moved less than the given deltas since the last full evaluation, candidates
+	 * keep their memoized obstacle and segmentation results, and only the comfort,
+	 * consistency, offset and dynamic costs are recomputed. A full evaluation is forced
+	 * every refresh_cycles cycles to bound the staleness. Not used with adaptive sampling.
+	 * Default is disabled.
+	 * \param max_pose_delta Largest change of the start arc length plus offset, meters. 0 disables reuse.
+	 * \param max_heading_delta Largest change of the start heading, radians.
+	 * \param refresh_cycles Cycles between full evaluations.
+	 */
+	void SetWarmStart(float max_pose_delta, float max_heading_delta, int refresh_cycles) {
+		warm_pose_delta_ = max_pose_delta;
+		warm_heading_delta_ = max_heading_delta;
+		warm_refresh_cycles_ = refresh_cycles;
+		warm_valid_ = false;
+	}
+
+	/**
+	 * Set the statistics the stages of CalculateCandidateCosts are timed into.
+	 * Timers are only compiled in when AVT_341_TIMING is defined.
+	 * \param stats The statistics, owned by the caller, or null to not time the planner.
+	 */
+	void SetTimingStats(StageTimingStats *stats) { timing_ = stats; }
+
 	float GetComfortabilityWeight() const { return w_c_; }
 	float GetStaticSafetyWeight() const { return w_s_; }
 	float GetDynamicSafetyWeight() const { return w_d_; }
@@ -168,39 +358,139 @@ public:
 	 */
 	void SetArcLengthIntegrationStep(float ds){ ds_ = ds; }
 
-	/**
-	 * Set the dynamic safety factors. See equations 19-20 of 
-	 * Hu et al. for further details.
-	 * 
-	 * \param alpha Limit of lateral acceleration, default = 5000.0
-	 * \param k Safety gain for speed adjustment, default = 0.8
-	 * \param v Reference speed for the path, default = 50.0
-	 */ 
-	void SetDynamicSafetyParams(float alpha, float k, float v){
-		alpha_max_ = alpha;
-		k_safe_ = k;
-		v_curve_ = v;
-	}
-
 private:
+	/// Centerline and previous path information at one arc length sample, shared by all candidates
+	struct PathSample {
+		float s;
+		float curvature;
+		float theta;
+		float last_theta;
+		PathFrame frame;
+	};
+
 	// private methods
 	std::vector<float> CalcCoeffs(float rho_start, float theta_start, float s_end, float rho_end);
-	void CalculateComfortability();
-	void CalculateStaticSafetyAndSegCost(const avt_341::msg::OccupancyGrid & grid,const avt_341::msg::OccupancyGrid & segmentation_grid);
-	void CalculateRhoCost();
-	void CalculateDynamicSafety(avt_341::msg::Odometry odom);
+	void TabulatePathSamples();
+	void AddCandidate(int index);
+	void BuildTemplate(CandidateTemplate &t);
+	float SampleRho(int i, int k) const;
+	float SampleSlope(int i, int k) const;
+	void ParallelFor(int first, int last, const std::function<void(int, int)> &func);
+	void CalculateComfortability(int first);
+	void ComfortabilityRange(int first, int last);
+	void CalculateStaticSafetyAndSegCost(const GridView &grid, const GridView &segmentation_grid);
+	void PrepareStaticSafety(const GridView &grid, const GridView &segmentation_grid, bool keep_results);
+	bool CanWarmStart() const;
+	void SaveWarmStartReference();
+	float ExtendStaticSafety(int first);
+	float RawStaticSafety(int i);
+	void EvaluateStaticSafety(int first);
+	void BlendStaticSafety(int i);
+	void UpdateNearestSampled();
+	void SampleGridPoint(int i, int k, float &gx, float &gy) const;
+	template <typename F> void TraverseCells(int i, F visit) const;
+	int SelectCandidate(bool in_bounds_only);
+	int SelectCandidateBranchAndBound(bool in_bounds_only);
+	int SampleAdaptively(const avt_341::msg::Odometry &odom);
+	void CalculateRhoCost(int first);
+	void CalculateDynamicSafety(const avt_341::msg::Odometry &odom, int first);
+	float DynamicSafetyOf(int i, float speed) const;
+	void DilateGrid(const GridView &grid, int x, float llx, float lly, float urx, float ury, std::vector<int8_t> &window, GridView &dilated);
+	void CalculateClearance(const GridView &grid, int wx0, int wy0, int wx1, int wy1);
+	static void DistanceTransform1D(const float *f, int n, float *d, int *v, float *z);
+	static void RunningMax(const int8_t *in, int n, int r, int8_t *out, std::vector<int8_t> &pad, std::vector<int8_t> &g, std::vector<int8_t> &h);
 	float GetTotalCostOfCandidate(int pathnum);
-	CurveInfo InfoOfCurve(Candidate candidate, float s, CurveInfo base_ca);
+	CurveInfo InfoOfCurve(const Candidate &candidate, float s, const CurveInfo &base_ca);
 
 	// centerline
 	Path path_;
 
 	// candidates
 	std::vector<Candidate> candidates_;
+	// coefficients of the candidates in SoA layout, same ordering as candidates_,
+	// left empty when the candidates come from a template
+	CandidateFan fan_;
+	// end offsets and horizons of the full lattice, and for each (horizon, offset) pair
+	// the candidate sampled there or -1, stored as lattice_candidate_[h*lattice_rho_.size() + j]
+	std::vector<float> lattice_rho_;
+	std::vector<float> lattice_s_end_;
+	std::vector<int> lattice_candidate_;
+	// lattice index of each candidate
+	std::vector<int> lattice_index_;
+	// candidate sampled nearest to each lattice point within its horizon, used for blending
+	std::vector<int> lattice_nearest_;
+	// spacing of the coarse fan in end offsets, 1 when every offset is sampled
+	int lattice_stride_;
+	float gen_rho_start_;
+	float gen_theta_start_;
+	// sample tables of the current lattice, null when the polynomials are evaluated
+	CandidateTemplateCache template_cache_;
+	const CandidateTemplate *template_;
+	CandidateFan template_fan_;
+	float template_rho_quantum_;
+	float template_theta_quantum_;
+
+	// per-sample table of the current cycle, s = 0, ds, 2ds, ... < s_max_
+	std::vector<PathSample> samples_;
+
+	// per-candidate scratch buffers reused by the fan kernels
+	std::vector<float> rho_buf_;
+	std::vector<float> drho_buf_;
+	std::vector<float> d2rho_buf_;
+	std::vector<float> curv_buf_;
+	std::vector<float> sum_buf_;
+	std::vector<float> sum2_buf_;
+	std::vector<float> max_buf_;
+
+	// static safety evaluation state of the current cycle, candidates are evaluated on demand
+	GridView check_grid_;
+	GridView check_seg_grid_;
+	int check_first_;
+	int check_count_;
+	std::vector<float> raw_static_;
+	std::vector<float> raw_seg_;
+	std::vector<char> static_done_;
+	std::vector<char> raw_hits_;
+	std::vector<float> lower_bound_buf_;
+	std::vector<int> order_buf_;
+
+	// clearance field in meters, full grid size but only valid in the current planning window
+	std::vector<float> clearance_;
+	std::vector<float> dt_tmp_;
+	std::vector<float> dt_f_;
+	std::vector<float> dt_d_;
+	std::vector<int> dt_v_;
+	std::vector<float> dt_z_;
+	// grid generation and window the clearance field was computed for
+	bool clearance_valid_;
+	unsigned int clearance_generation_;
+	int clearance_window_[4];
 
 	// optimal path
 	Candidate last_selected_;
 
+	// received grids, and views of the received data with the dilated windows
+	avt_341::msg::OccupancyGridConstPtr grid_msg_;
+	avt_341::msg::OccupancyGridConstPtr segmentation_grid_msg_;
+	GridView grid_;
+	GridView segmentation_grid_;
+	std::vector<int8_t> dilated_grid_;
+	std::vector<int8_t> dilated_segmentation_grid_;
+	// scratch buffers for the separable dilation
+	std::vector<int8_t> dilate_tmp_;
+	std::vector<int8_t> dilate_line_;
+	std::vector<int8_t> dilate_pad_;
+	std::vector<int8_t> dilate_g_;
+	std::vector<int8_t> dilate_h_;
+	// changes whenever the data viewed by grid_, segmentation_grid_ or path_ changes
+	unsigned int grid_generation_;
+	unsigned int segmentation_generation_;
+	unsigned int path_generation_;
+	// oriented footprint masks and bit packed obstacles
+	VehicleFootprint footprint_;
+	// predicted moving obstacles
+	DynamicObstacleMap dynamic_obstacles_;
+
 	// state variables to track
 	bool first_iter_;
 	float s_max_;
@@ -213,15 +503,41 @@ private:
 	float w_d_;
 	float w_r_;
 	float w_t_;
-	float alpha_max_; 
-	float k_safe_;
-	float v_curve_;
 	float a_;
 	float b_;
 	float ds_;
 	float s_no_coll_before_;
+	float collision_radius_;
+	float clearance_cost_dist_;
+	float dynamic_radius_;
+	float dynamic_cost_dist_;
+	float dynamic_horizon_;
+	int dynamic_stride_;
 	int averaging_window_size_;
 	bool use_blend_;
+	bool prune_candidates_;
+	int adaptive_coarse_paths_;
+	int adaptive_budget_;
+	int num_horizons_;
+	// state of the last full evaluation, for reusing the grid checks
+	float warm_pose_delta_;
+	float warm_heading_delta_;
+	int warm_refresh_cycles_;
+	bool warm_valid_;
+	int warm_cycles_;
+	unsigned int warm_grid_generation_;
+	unsigned int warm_segmentation_generation_;
+	unsigned int warm_path_generation_;
+	int warm_num_candidates_;
+	float warm_s_max_;
+	float warm_ds_;
+	float warm_s_start_;
+	float warm_rho_start_;
+	float warm_theta_start_;
+	// null when scoring runs on the calling thread only
+	std::shared_ptr<ThreadPool> pool_;
+	// stage timing statistics, not owned, may be null
+	StageTimingStats *timing_;
 };
 
 } // namespace planning
@@ -13,6 +13,7 @@
 
 #include "avt_341/avt_341_utils.h"
 #include "avt_341/planning/local/candidate.h"
+#include "avt_341/planning/local/grid_view.h"
 #include "avt_341/visualization/base_visualizer.h"
 
 // ros includes
@@ -45,7 +46,14 @@ public:
 	 * Add the occupancy grid that will be plotted
 	 * \param grid The occupancy grid to be plotted. 
 	 */
-	void AddMap(avt_341::msg::OccupancyGrid grid);
+	void AddMap(const avt_341::msg::OccupancyGrid &grid);
+
+	/**
+	 * Add the grid the planner checks against, for example its dilated grid.
+	 * The cells are copied, so the view may change after the call.
+	 * \param grid The grid view to be plotted.
+	 */
+	void AddMap(const GridView &grid);
 
 	/**
 	 * Add a list of global waypoints to be plotted
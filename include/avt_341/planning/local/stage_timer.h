@@ -0,0 +1,114 @@
+/**
+ * \class StageTimingStats
+ *
+ * Rolling timing statistics of the stages of a local planner cycle.
+ * Durations are measured with a monotonic clock by scoped timers, which are
+ * only compiled in when AVT_341_TIMING is defined, and the last window of
+ * samples of each stage is kept for percentile queries.
+ *
+ * \date 10/17/2026
+ */
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <vector>
+#include <chrono>
+
+namespace avt_341 {
+namespace planning{
+
+/// Timed stages of a local planner cycle.
+enum PlannerStage {
+	STAGE_PATH,
+	STAGE_GENERATE_PATHS,
+	STAGE_DILATE_GRID,
+	STAGE_PATH_SAMPLES,
+	STAGE_COMFORT,
+	STAGE_RHO_COST,
+	STAGE_PREPARE_STATIC,
+	STAGE_DYNAMIC_SAFETY,
+	STAGE_STATIC_SAFETY,
+	STAGE_PUBLISH,
+	STAGE_CYCLE,
+	NUM_PLANNER_STAGES
+};
+
+/// Percentiles of the durations in the window of a stage, in seconds.
+struct StagePercentiles {
+	double p50;
+	double p95;
+	double p99;
+	double max;
+	int count;
+};
+
+class StageTimingStats {
+public:
+	/**
+	 * Create empty statistics.
+	 * \param window Number of most recent samples kept per stage.
+	 */
+	StageTimingStats(int window = 500);
+
+	/**
+	 * Add a duration to a stage, replacing the oldest sample once the window is full.
+	 * \param stage The stage, one of PlannerStage.
+	 * \param seconds The duration.
+	 */
+	void Add(int stage, double seconds);
+
+	/**
+	 * Get the percentiles of the samples in the window of a stage.
+	 * \param stage The stage, one of PlannerStage.
+	 */
+	StagePercentiles Percentiles(int stage);
+
+	/**
+	 * Get the name of a stage.
+	 * \param stage The stage, one of PlannerStage.
+	 */
+	static const char *StageName(int stage);
+
+private:
+	struct StageWindow {
+		std::vector<double> samples;
+		int next;
+	};
+	std::vector<StageWindow> stages_;
+	std::vector<double> scratch_;
+	int window_;
+};
+
+/**
+ * Adds the time from its construction to its destruction to a stage of the statistics.
+ * Does nothing if the statistics are null.
+ */
+class ScopedStageTimer {
+public:
+	ScopedStageTimer(StageTimingStats *stats, int stage) : stats_(stats), stage_(stage) {
+		if (stats_) start_ = std::chrono::steady_clock::now();
+	}
+
+	~ScopedStageTimer() {
+		if (stats_) stats_->Add(stage_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+	}
+
+private:
+	StageTimingStats *stats_;
+	int stage_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+// Times the rest of the enclosing scope, compiled out unless AVT_341_TIMING is defined
+#define AVT_341_TIMER_CONCAT_(a, b) a##b
+#define AVT_341_TIMER_NAME_(line) AVT_341_TIMER_CONCAT_(avt_341_scoped_timer_, line)
+#ifdef AVT_341_TIMING
+#define AVT_341_SCOPED_TIMER(stats, stage) avt_341::planning::ScopedStageTimer AVT_341_TIMER_NAME_(__LINE__)((stats), (stage))
+#else
+#define AVT_341_SCOPED_TIMER(stats, stage)
+#endif
+
+#endif
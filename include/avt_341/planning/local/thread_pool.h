@@ -0,0 +1,75 @@
+/**
+ * \class ThreadPool
+ *
+ * Fixed set of worker threads for fork-join loops of the planner.
+ * ParallelFor splits an index range into one contiguous chunk per thread,
+ * runs the first chunk on the calling thread and returns when all
+ * chunks are done, so the workers sleep between planning cycles.
+ * A pool may only be used by one calling thread at a time.
+ *
+ * \date 10/17/2026
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace avt_341 {
+namespace planning{
+
+class ThreadPool {
+public:
+	/**
+	 * Create a pool and start its workers.
+	 * \param num_threads Total number of threads including the calling thread.
+	 */
+	ThreadPool(int num_threads);
+
+	/**
+	 * Stop and join the workers.
+	 */
+	~ThreadPool();
+
+	/**
+	 * Get the number of threads including the calling thread.
+	 */
+	int GetNumThreads() const { return (int)workers_.size() + 1; }
+
+	/**
+	 * Run func(begin, end) on contiguous chunks covering [first, last), in parallel.
+	 * Chunks of different threads do not overlap, so func may write per-index
+	 * outputs without locking.
+	 * \param first First index of the range.
+	 * \param last One past the last index of the range.
+	 * \param func Function run on each chunk.
+	 */
+	void ParallelFor(int first, int last, const std::function<void(int, int)> &func);
+
+private:
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	void WorkerLoop(int chunk);
+	int ChunkStart(int chunk) const;
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable work_cv_;
+	std::condition_variable done_cv_;
+	// current task, valid while pending_ > 0
+	const std::function<void(int, int)> *task_;
+	int task_first_;
+	int task_last_;
+	int num_chunks_;
+	unsigned int task_id_;
+	int pending_;
+	bool stop_;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
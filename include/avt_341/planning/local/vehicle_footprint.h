@@ -0,0 +1,114 @@
+/**
+ * \class VehicleFootprint
+ *
+ * Collision checking of the rectangular vehicle footprint against an occupancy grid.
+ * The footprint is rasterized once per heading bin at the grid resolution
+ * and the masks are kept until the resolution or the footprint changes.
+ * Occupied cells are packed into one bit per cell along grid columns,
+ * so testing a footprint costs one or two word tests per mask column.
+ *
+ * \date 10/17/2026
+ */
+#ifndef SPLINE_VEHICLE_FOOTPRINT_H
+#define SPLINE_VEHICLE_FOOTPRINT_H
+
+#include <vector>
+#include <cstdint>
+#include "avt_341/planning/local/grid_view.h"
+
+namespace avt_341 {
+namespace planning{
+
+class VehicleFootprint {
+public:
+	/**
+	 * Create a disabled footprint.
+	 */
+	VehicleFootprint();
+
+	/**
+	 * Set the size of the rectangular footprint, centered on the path point.
+	 * A length or width of zero disables footprint checking.
+	 * \param length Length of the vehicle along its heading, meters.
+	 * \param width Width of the vehicle, meters.
+	 */
+	void SetSize(float length, float width);
+
+	/**
+	 * Set the number of heading bins over 180 degrees. The footprint is
+	 * symmetric, so opposite headings share a mask. Default is 32.
+	 * \param nbins Number of bins.
+	 */
+	void SetNumHeadingBins(int nbins);
+
+	/**
+	 * Return true if a footprint size has been set.
+	 */
+	bool Enabled() const { return length_ > 0.0f && width_ > 0.0f; }
+
+	/**
+	 * Radius of the circle around the footprint center that contains the whole footprint.
+	 */
+	float CircumscribedRadius() const;
+
+	/**
+	 * Radius around the center cell that contains every cell of the masks,
+	 * the circumscribed radius grown by the margin of the masks.
+	 * \param resolution Grid resolution, meters.
+	 */
+	float MaskRadius(float resolution) const;
+
+	/**
+	 * Prepare for collision checks on a grid.
+	 * Masks are rebuilt if the resolution changed and the bit map
+	 * is rebuilt if the generation of the grid data changed.
+	 * \param grid The grid to check against.
+	 * \param generation Counter that changes whenever the grid data changes.
+	 */
+	void Update(const GridView &grid, unsigned int generation);
+
+	/**
+	 * Get the heading bin of a heading angle.
+	 * \param heading Heading in radians.
+	 */
+	int HeadingBin(float heading) const;
+
+	/**
+	 * Return true if the footprint at a cell and heading bin overlaps an occupied cell.
+	 * \param ix Grid column of the footprint center.
+	 * \param iy Grid row of the footprint center.
+	 * \param bin Heading bin from HeadingBin.
+	 */
+	bool Collides(int ix, int iy, int bin) const;
+
+private:
+	/// One column of a rasterized mask, rows jlo to jhi relative to the center cell
+	struct MaskColumn {
+		int di;
+		int jlo;
+		int jhi;
+	};
+
+	float Grow(float resolution) const;
+	void BuildMasks(float resolution);
+	bool AnySet(int col, int j0, int j1) const;
+
+	float length_;
+	float width_;
+	int nbins_;
+	float mask_resolution_;
+	std::vector<std::vector<MaskColumn> > masks_;
+
+	// bit packed obstacle map, one bit per cell, columns padded to whole words
+	std::vector<uint64_t> bits_;
+	int words_per_column_;
+	int width_cells_;
+	int height_cells_;
+	unsigned int bits_generation_;
+	bool bits_valid_;
+};
+
+} // namespace planning
+} // namespace avt_341
+
+#endif
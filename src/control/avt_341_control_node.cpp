@@ -2,7 +2,8 @@
  * \file avt_341_control_node.cpp
  *
  * ROS node to subsribe to a trajectory message and 
- * convert it to a driving command using the pure-pursuit algorithm
+ * convert it to a driving command using the pure-pursuit algorithm,
+ * or a model predictive controller when ~controller is "mpc"
  * 
  * \author Chris Goodin
  *
@@ -15,10 +16,14 @@
 #include "avt_341/node/node_proxy.h"
 //avt_341 includes
 #include "avt_341/control/pure_pursuit_controller.h"
+#include "avt_341/control/mpc_controller.h"
+#include "avt_341/control/velocity_profile.h"
+#include "avt_341/control/state_predictor.h"
 
 avt_341::msg::Path control_msg;
 avt_341::msg::Odometry state;
 int current_run_state = -1;   // startup state
+bool new_path_rcvd = false;
 
 void OdometryCallback(avt_341::msg::OdometryPtr rcv_state) {
 	state = *rcv_state; 
@@ -27,49 +32,13 @@ void OdometryCallback(avt_341::msg::OdometryPtr rcv_state) {
 void PathCallback(avt_341::msg::PathPtr rcv_control){
   control_msg.poses = rcv_control->poses;
   control_msg.header = rcv_control->header;
+  new_path_rcvd = true;
 }
 
 void StateCallback(avt_341::msg::Int32Ptr rcv_state){
   current_run_state = rcv_state->data;
 }
 
-double length(avt_341::msg::Point a, avt_341::msg::Point b){
-  double dx = a.x - b.x;
-  double dy = a.y - b.y;
-  double dz = a.z - b.z;
-  return sqrt(dx*dx + dy*dy + dz*dz);
-}
-
-float TriangleArea(avt_341::msg::Point a, avt_341::msg::Point b, avt_341::msg::Point c) {
-	float area = (float)fabs(a.x*(b.y - c.y) + b.x*(c.y - a.y) + c.x*(a.y - b.y));
-	return area;
-}
-
-float MengerCurvature(avt_341::msg::Point a, avt_341::msg::Point b, avt_341::msg::Point c) {
-	float curv = 0.0f;
-	float denom = length(a, b)*length(b, c)*length(c, b);
-	if (denom == 0.0f) {
-		curv = std::numeric_limits<float>::max();
-	}
-	else {
-		float area = TriangleArea(a, b, c);
-		curv = 4.0f*area / denom;
-	}
-	return curv;
-}
-
-double GetMaxCurvature(avt_341::msg::Path path){
-  double max_curvature = 0.0;
-  if (path.poses.size() > 2) {
-		for (int i = 1; i < path.poses.size() - 1; i++){
-		  double curvature = MengerCurvature(path.poses[i - 1].pose.position, path.poses[i].pose.position, path.poses[i + 1].pose.position);
-      if (curvature>max_curvature)max_curvature = curvature;
-		}
-	}
-  return max_curvature;
-}
-
-
 int main(int argc, char *argv[]){
   auto n = avt_341::node::init_node(argc,argv,"avt_341_control_node");
 
@@ -85,7 +54,7 @@ int main(int argc, char *argv[]){
  avt_341::control::PurePursuitController controller;
 	// Set controller parameters
 	float wheelbase, steer_angle, vehicle_speed, steering_coeff, throttle_coeff, time_to_max_brake;
-  float throttle_kp, throttle_ki, throttle_kd, max_desired_lateral_g;
+  float throttle_kp, throttle_ki, throttle_kd, max_desired_lateral_g, max_acceleration, max_deceleration;
 	std::string display;
 	n->get_parameter("~vehicle_wheelbase", wheelbase, 2.6f);
   n->get_parameter("~vehicle_max_steer_angle_degrees", steer_angle, 25.0f);
@@ -101,6 +70,15 @@ int main(int argc, char *argv[]){
   n->get_parameter("~throttle_kd", throttle_kd, 0.24f);
   n->get_parameter("~display", display, std::string("none"));
   n->get_parameter("~max_desired_lateral_g", max_desired_lateral_g, 0.75f);
+  n->get_parameter("~max_acceleration", max_acceleration, 1.0f);
+  n->get_parameter("~max_deceleration", max_deceleration, 2.0f);
+
+  // the state is predicted over the age of the odometry plus the time for a command to take effect
+  bool latency_compensation;
+  float actuation_latency, max_latency_compensation;
+  n->get_parameter("~latency_compensation", latency_compensation, false);
+  n->get_parameter("~actuation_latency", actuation_latency, 0.05f);
+  n->get_parameter("~max_latency_compensation", max_latency_compensation, 0.3f);
 
   bool turn_off_velocity_overshoot_corrector;
   n->get_parameter("~turn_off_velocity_overshoot_corrector", turn_off_velocity_overshoot_corrector, false);
@@ -111,6 +89,19 @@ int main(int argc, char *argv[]){
   float skid_kl, skid_kt;
   n->get_parameter("~skid_kl", skid_kl, 1.0f);
   n->get_parameter("~skid_kt", skid_kt, 1.0f);
+
+  // the model predictive controller only handles Ackermann steering
+  std::string controller_type;
+  n->get_parameter("~controller", controller_type, std::string("pure_pursuit"));
+  bool use_mpc = controller_type == "mpc" && !skid_steered;
+  float mpc_time_step, mpc_lateral_weight, mpc_heading_weight, mpc_steering_weight, mpc_steering_rate_weight;
+  int mpc_max_iterations;
+  n->get_parameter("~mpc_time_step", mpc_time_step, 0.05f);
+  n->get_parameter("~mpc_lateral_weight", mpc_lateral_weight, 1.0f);
+  n->get_parameter("~mpc_heading_weight", mpc_heading_weight, 1.0f);
+  n->get_parameter("~mpc_steering_weight", mpc_steering_weight, 0.1f);
+  n->get_parameter("~mpc_steering_rate_weight", mpc_steering_rate_weight, 1.0f);
+  n->get_parameter("~mpc_max_iterations", mpc_max_iterations, 50);
   
 
   if (skid_steered){
@@ -126,6 +117,12 @@ int main(int argc, char *argv[]){
   }
   
   controller.SetDesiredSpeed(vehicle_speed);
+  avt_341::control::StatePredictor predictor;
+  predictor.IsSkidSteered(skid_steered);
+  predictor.SetWheelbase(wheelbase);
+  predictor.SetMaxSteering(steer_angle*3.14159 / 180.0);
+  avt_341::control::VelocityProfile profile;
+  profile.SetLimits(vehicle_speed, max_desired_lateral_g, max_acceleration, max_deceleration);
   if (turn_off_velocity_overshoot_corrector){
     controller.GetPidSpeedController()->SetOvershootLimiter(false);
   }
@@ -135,11 +132,34 @@ int main(int argc, char *argv[]){
 
   float rate = 100.0f;
   float dt = 1.0f/rate;
+
+  avt_341::control::MpcController mpc;
+  mpc.SetThrottleCoeff(throttle_coeff);
+  mpc.SetWheelbase(wheelbase);
+  mpc.SetMaxSteering(steer_angle*3.14159 / 180.0);
+  mpc.SetSpeedControllerParams(throttle_kp, throttle_ki, throttle_kd);
+  mpc.SetTimeStep(mpc_time_step);
+  mpc.SetControlPeriod(dt);
+  mpc.SetWeights(mpc_lateral_weight, mpc_heading_weight, mpc_steering_weight, mpc_steering_rate_weight);
+  mpc.SetMaxIterations(mpc_max_iterations);
+  if (turn_off_velocity_overshoot_corrector){
+    mpc.GetPidSpeedController()->SetOvershootLimiter(false);
+  }
+
   float brake_step = dt/time_to_max_brake;
   float current_brake_value = 0.0;
 
   avt_341::node::Rate r(rate);
   avt_341::utils::vec2 goal;
+  // drive along the path at a target speed with the selected controller
+  auto drive = [&](float speed) -> avt_341::msg::Twist {
+    if (use_mpc){
+      mpc.SetDesiredSpeed(speed);
+      return mpc.GetDcFromPath(goal);
+    }
+    controller.SetDesiredSpeed(speed);
+    return controller.GetDcFromPath(goal);
+  };
  // std::cout<< "Vehicle is at" << state.pose.pose.position.x << std::endl;
 
    // if (fabs(state.pose.pose.position.x) > 1.0 || fabs(state.pose.pose.position.y) > 1.0)
@@ -151,30 +171,43 @@ int main(int argc, char *argv[]){
     avt_341::msg::Twist dc;
     bool time_to_quit = false;
    // tell the controller the current vehicle state
-    controller.SetVehicleState(state);
+    double odom_stamp = avt_341::node::seconds_from_header(state.header);
+    predictor.AddOdometry(state, odom_stamp);
+    if (latency_compensation && predictor.HasOdometry()){
+      // unstamped odometry only gets the actuation latency
+      double latency = actuation_latency;
+      if (odom_stamp > 0.0) latency += n->get_now_seconds() - odom_stamp;
+      latency = std::max(0.0, std::min((double)max_latency_compensation, latency));
+      avt_341::msg::Odometry predicted = predictor.Predict(latency);
+      if (use_mpc) mpc.SetVehicleState(predicted);
+      else controller.SetVehicleState(predicted);
+    }
+    else {
+      if (use_mpc) mpc.SetVehicleState(state);
+      else controller.SetVehicleState(state);
+    }
+    // paths are only converted for the controller and profiled when they change
+    if (new_path_rcvd){
+      if (use_mpc) mpc.SetPath(control_msg);
+      else controller.SetPath(control_msg);
+      profile.Compute(control_msg);
+      new_path_rcvd = false;
+    }
 
     if (current_run_state==0){    // active running state
-      double max_curvature = GetMaxCurvature(control_msg);
-      float vel = sqrtf(state.twist.twist.linear.x*state.twist.twist.linear.x + state.twist.twist.linear.y*state.twist.twist.linear.y);
-      double lateral_g_force = ((vel*vel)*max_curvature)/9.806;
-      float desired_velocity = vehicle_speed;
-      if (lateral_g_force>max_desired_lateral_g){
-        desired_velocity = sqrt(9.806*max_desired_lateral_g/max_curvature);
-      }
-      controller.SetDesiredSpeed(desired_velocity);
-      dc = controller.GetDcFromTraj(control_msg, goal);
+      // target speed of the profile at the segment tracked on the last tick
+      int track_index = use_mpc ? mpc.GetTrackIndex() : controller.GetTrackIndex();
+      dc = drive(profile.GetSpeed(track_index));
     }
     else if (current_run_state==-1 || current_run_state==1){
       // bring to a smooth stop and wait / idle
-      controller.SetDesiredSpeed(0.0f);
-      dc = controller.GetDcFromTraj(control_msg, goal);
+      dc = drive(0.0f);
     }
     else if (current_run_state==2){ 
       // bring to a smooth stop and shut down
-      controller.SetDesiredSpeed(0.0f);
       float vel = sqrtf(state.twist.twist.linear.x*state.twist.twist.linear.x + state.twist.twist.linear.y*state.twist.twist.linear.y);
       if (vel<0.5f)time_to_quit = true;
-      dc = controller.GetDcFromTraj(control_msg, goal);
+      dc = drive(0.0f);
       dc.linear.x = 0.0f;
       dc.angular.z = 0.0f;
 
@@ -203,6 +236,7 @@ int main(int argc, char *argv[]){
 
     // publish the driving command
     dc_pub->publish(dc);
+    predictor.SetSteeringCommand(dc.angular.z);
     current_brake_value = dc.linear.y;
 
     // break the loop when an end state is reached
@@ -0,0 +1,239 @@
+#include "avt_341/control/mpc_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace avt_341 {
+namespace control{
+
+MpcController::MpcController() {
+	// MRZR values, like the pure pursuit controller
+	wheelbase_ = 2.731f;
+	max_steering_angle_ = 0.69f;
+	max_stable_speed_ = 35.0f;
+	desired_speed_ = 0.0f;
+	throttle_coeff_ = 1.0f;
+
+	// 1 second horizon
+	dt_ = 0.05f;
+	q_lateral_ = 1.0f;
+	q_heading_ = 1.0f;
+	r_steering_ = 0.1f;
+	r_steering_rate_ = 1.0f;
+	max_iterations_ = 50;
+	control_period_ = 0.01f;
+
+	veh_x_ = 0.0f;
+	veh_y_ = 0.0f;
+	veh_heading_ = 0.0f;
+	veh_speed_ = 0.0f;
+	vx_ = 0.0f;
+	vy_ = 0.0f;
+
+	for (int i = 0; i < horizon_; i++) {
+		u_[i] = 0.0f;
+		f_[i] = 0.0f;
+		for (int j = 0; j < horizon_; j++) h_[i][j] = 0.0f;
+	}
+	warm_ = false;
+	last_steering_ = 0.0f;
+	last_iterations_ = 0;
+}
+
+void MpcController::SetVehicleState(avt_341::msg::Odometry state){
+	veh_x_ = state.pose.pose.position.x;
+	veh_y_ = state.pose.pose.position.y;
+	vx_ = state.twist.twist.linear.x;
+	vy_ = state.twist.twist.linear.y;
+	veh_speed_ = sqrt(vx_*vx_ + vy_*vy_);
+	veh_heading_ = utils::GetHeadingFromOrientation(state.pose.pose.orientation);
+}
+
+void MpcController::SetPath(const avt_341::msg::Path &traj) {
+	tracker_.SetPath(traj);
+}
+
+float MpcController::CurvatureAt(float s, int &hint) const {
+	// the hint only moves forward, as the horizon points are visited in order
+	const std::vector<float> &path_s = tracker_.GetArcLengths();
+	const std::vector<float> &path_k = tracker_.GetCurvatures();
+	int np = path_s.size();
+	while (hint < np - 2 && path_s[hint + 1] <= s) hint++;
+	float ds = path_s[hint + 1] - path_s[hint];
+	if (ds <= 0.0f) return path_k[hint];
+	float t = std::max(0.0f, std::min(1.0f, (s - path_s[hint]) / ds));
+	return path_k[hint] + t*(path_k[hint + 1] - path_k[hint]);
+}
+
+int MpcController::SolveQp() {
+	// step size from the largest absolute row sum of H, which bounds its largest eigenvalue
+	float lipschitz = 0.0f;
+	for (int i = 0; i < horizon_; i++) {
+		float row = 0.0f;
+		for (int j = 0; j < horizon_; j++) row += fabs(h_[i][j]);
+		lipschitz = std::max(lipschitz, row);
+	}
+	if (lipschitz <= 0.0f) return 0;
+	float step = 1.0f / lipschitz;
+	float umax = tanf(max_steering_angle_);
+
+	// accelerated projected gradient, the momentum is dropped when it points uphill
+	float y[horizon_];
+	float u_new[horizon_];
+	float grad[horizon_];
+	for (int i = 0; i < horizon_; i++) y[i] = u_[i];
+	float t = 1.0f;
+	int iter = 0;
+	while (iter < max_iterations_) {
+		iter++;
+		for (int i = 0; i < horizon_; i++) {
+			float g = f_[i];
+			for (int j = 0; j < horizon_; j++) g += h_[i][j] * y[j];
+			grad[i] = g;
+		}
+		float change = 0.0f;
+		float uphill = 0.0f;
+		for (int i = 0; i < horizon_; i++) {
+			u_new[i] = std::max(-umax, std::min(umax, y[i] - step*grad[i]));
+			float du = u_new[i] - u_[i];
+			change = std::max(change, (float)fabs(du));
+			uphill += (y[i] - u_new[i]) * du;
+		}
+		float t_next = 0.5f*(1.0f + sqrtf(1.0f + 4.0f*t*t));
+		float beta = (t - 1.0f) / t_next;
+		if (uphill > 0.0f) {
+			beta = 0.0f;
+			t_next = 1.0f;
+		}
+		for (int i = 0; i < horizon_; i++) {
+			y[i] = u_new[i] + beta*(u_new[i] - u_[i]);
+			u_[i] = u_new[i];
+		}
+		t = t_next;
+		if (change < 1.0E-5f) break;
+	}
+	return iter;
+}
+
+avt_341::msg::Twist MpcController::GetDcFromPath(utils::vec2 & goal) {
+	avt_341::msg::Twist dc;
+	const std::vector<utils::vec2> &path = tracker_.GetPoints();
+	const std::vector<float> &path_s = tracker_.GetArcLengths();
+	int np = path.size();
+	if (np < 2) return dc;
+
+	utils::vec2 currpos(veh_x_, veh_y_);
+	tracker_.Update(currpos);
+	int seg = tracker_.GetTrackIndex();
+
+	// errors to the closest point of the tracked segment, lateral is positive to the left
+	utils::vec2 v = path[seg + 1] - path[seg];
+	float seg_dist = path_s[seg + 1] - path_s[seg];
+	utils::vec2 dir = seg_dist > 0.0f ? v / seg_dist : utils::vec2(cosf(veh_heading_), sinf(veh_heading_));
+	utils::vec2 rel = currpos - path[seg];
+	float along = std::max(0.0f, std::min(seg_dist, utils::dot(rel, dir)));
+	float s0 = path_s[seg] + along;
+	float ey = dir.x*rel.y - dir.y*rel.x;
+	float dheading = veh_heading_ - atan2f(dir.y, dir.x);
+	float epsi = atan2f(sinf(dheading), cosf(dheading));
+
+	// The model is linearized at the current speed, with a lower limit so the
+	// steering still converges to the path when starting from rest.
+	// The input is the tangent of the steering angle, which makes the heading rate exact.
+	//   e_y(k+1) = e_y(k) + a*e_psi(k)
+	//   e_psi(k+1) = e_psi(k) + b*u(k) - a*kappa(k)
+	// with a = v*dt, b = v*dt/wheelbase.
+	// The errors after k+1 steps are then the free response plus
+	//   sum_{j<=k} (k-j)*a*b*u(j) for e_y and sum_{j<=k} b*u(j) for e_psi.
+	float speed = std::max(veh_speed_, 1.0f);
+	float a = speed*dt_;
+	float b = a / wheelbase_;
+	float y_free[horizon_];
+	float psi_free[horizon_];
+	int hint = seg;
+	float y_k = ey;
+	float psi_k = epsi;
+	float kappa[horizon_];
+	for (int k = 0; k < horizon_; k++) {
+		kappa[k] = CurvatureAt(s0 + a*k, hint);
+		y_k = y_k + a*psi_k;
+		psi_k = psi_k - a*kappa[k];
+		y_free[k] = y_k;
+		psi_free[k] = psi_k;
+	}
+
+	// cost sum_k q_lat*e_y^2 + q_head*e_psi^2 + r*u^2 + r_rate*(u(k)-u(k-1))^2,
+	// where row k of the errors holds step k+1 and u(-1) is the applied steering
+	float ab = a*b;
+	for (int i = 0; i < horizon_; i++) {
+		for (int j = i; j < horizon_; j++) {
+			float hy = 0.0f;
+			for (int k = j; k < horizon_; k++) hy += (float)(k - i)*(float)(k - j);
+			float val = q_lateral_*ab*ab*hy + q_heading_*b*b*(float)(horizon_ - j);
+			h_[i][j] = val;
+			h_[j][i] = val;
+		}
+		h_[i][i] += r_steering_ + r_steering_rate_*(i < horizon_ - 1 ? 2.0f : 1.0f);
+		if (i > 0) {
+			h_[i][i - 1] -= r_steering_rate_;
+			h_[i - 1][i] -= r_steering_rate_;
+		}
+		float fy = 0.0f;
+		float fpsi = 0.0f;
+		for (int k = i; k < horizon_; k++) {
+			fy += (float)(k - i)*y_free[k];
+			fpsi += psi_free[k];
+		}
+		f_[i] = q_lateral_*ab*fy + q_heading_*b*fpsi;
+	}
+	f_[0] -= r_steering_rate_*last_steering_;
+
+	// start from the previous solution moved forward by one control period,
+	// or from the path curvature
+	float umax = tanf(max_steering_angle_);
+	if (warm_) {
+		float shift = std::max(0.0f, std::min(1.0f, control_period_ / dt_));
+		for (int i = 0; i < horizon_ - 1; i++) u_[i] += shift*(u_[i + 1] - u_[i]);
+	}
+	else {
+		for (int i = 0; i < horizon_; i++) u_[i] = std::max(-umax, std::min(umax, wheelbase_*kappa[i]));
+	}
+	warm_ = true;
+	last_iterations_ = SolveQp();
+	last_steering_ = u_[0];
+
+	float sangle = atanf(u_[0]) / max_steering_angle_;
+	sangle = std::min(1.0f, sangle);
+	sangle = std::max(-1.0f, sangle);
+	dc.angular.z = sangle;
+
+	// the goal is the reference point at the end of the horizon
+	float s_goal = std::min(s0 + a*horizon_, path_s[np - 1]);
+	int i = (int)(std::upper_bound(path_s.begin() + seg + 1, path_s.end(), s_goal) - path_s.begin()) - 1;
+	goal = path[np - 1];
+	if (i < np - 1 && path_s[i + 1] > path_s[i]) {
+		float t = (s_goal - path_s[i]) / (path_s[i + 1] - path_s[i]);
+		goal = path[i] + (path[i + 1] - path[i])*t;
+	}
+
+	//Use the speed controller to get throttle/braking,
+	//backing off during hard turns like the pure pursuit controller
+	float target_speed = std::min(desired_speed_, max_stable_speed_);
+	float adj_speed = target_speed * exp(-0.69*pow(fabs(dc.angular.z), 4.0f));
+	speed_controller_.SetSetpoint(adj_speed);
+	float vdot = vx_*cosf(veh_heading_) + vy_*sinf(veh_heading_);
+	float throttle = speed_controller_.GetControlVariable(vdot, 0.1f);
+	if (throttle < 0.0f) { //braking
+		dc.linear.x = 0.0f;
+		dc.linear.y = std::max(-1.0f, throttle);
+	}
+	else {
+		dc.linear.y = 0.0f;
+		dc.linear.x = std::min(1.0f, throttle);
+	}
+	dc.linear.x = throttle_coeff_*dc.linear.x;
+
+	return dc;
+}
+
+} // namespace control
+} // namespace avt_341
@@ -0,0 +1,69 @@
+#include "avt_341/control/path_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace avt_341 {
+namespace control{
+
+PathTracker::PathTracker() {
+	track_index_ = -1;
+	track_dist_ = 0.0f;
+	lock_dist_ = 0.0f;
+	relock_dist_ = 2.0f;
+}
+
+void PathTracker::SetPath(const avt_341::msg::Path &traj) {
+	// the vectors keep their capacity, so paths of similar size are not reallocated
+	int np = traj.poses.size();
+	points_.resize(np);
+	s_.resize(np);
+	k_.assign(np, 0.0f);
+	for (int i = 0; i < np; i++) {
+		points_[i] = utils::vec2(traj.poses[i].pose.position.x, traj.poses[i].pose.position.y);
+		s_[i] = i == 0 ? 0.0f : s_[i - 1] + utils::length(points_[i] - points_[i - 1]);
+	}
+	// the end points take the curvature of their neighbor
+	for (int i = 1; i < np - 1; i++) k_[i] = utils::MengerCurvature(points_[i - 1], points_[i], points_[i + 1]);
+	if (np > 2) {
+		k_[0] = k_[1];
+		k_[np - 1] = k_[np - 2];
+	}
+	track_index_ = -1;
+}
+
+void PathTracker::Search(utils::vec2 pos) {
+	int nseg = (int)points_.size() - 1;
+	track_dist_ = 1.0E9f;
+	track_index_ = 0;
+	for (int i = 0; i < nseg; i++) {
+		float d0 = fabs(utils::PointToSegmentDistance(points_[i], points_[i + 1], pos));
+		if (d0 < track_dist_) {
+			track_dist_ = d0;
+			track_index_ = i;
+		}
+	}
+	lock_dist_ = track_dist_;
+}
+
+void PathTracker::Update(utils::vec2 pos) {
+	int nseg = (int)points_.size() - 1;
+	if (nseg < 1) return;
+	if (track_index_ < 0 || track_index_ >= nseg) {
+		Search(pos);
+		return;
+	}
+	// otherwise advance while the next segment is at least as close, comparing unsigned
+	// distances since PointToSegmentDistance is signed between the end points
+	track_dist_ = fabs(utils::PointToSegmentDistance(points_[track_index_], points_[track_index_ + 1], pos));
+	while (track_index_ < nseg - 1) {
+		float d0 = fabs(utils::PointToSegmentDistance(points_[track_index_ + 1], points_[track_index_ + 2], pos));
+		if (d0 > track_dist_) break;
+		track_dist_ = d0;
+		track_index_++;
+	}
+	if (track_dist_ > lock_dist_ + relock_dist_) Search(pos);
+	else lock_dist_ = std::min(lock_dist_, track_dist_);
+}
+
+} // namespace control
+} // namespace avt_341
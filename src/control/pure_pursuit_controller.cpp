@@ -1,4 +1,5 @@
 #include "avt_341/control/pure_pursuit_controller.h"
+#include <algorithm>
 
 namespace avt_341 {
 namespace control{
@@ -42,23 +43,25 @@ void PurePursuitController::SetVehicleState(avt_341::msg::Odometry state){
 }
 
 avt_341::msg::Twist PurePursuitController::GetDcFromTraj(avt_341::msg::Path traj, utils::vec2 & goal) {
+	SetPath(traj);
+	return GetDcFromPath(goal);
+}
+
+void PurePursuitController::SetPath(const avt_341::msg::Path &traj) {
+	tracker_.SetPath(traj);
+}
+
+avt_341::msg::Twist PurePursuitController::GetDcFromPath(utils::vec2 & goal) {
 	//initialize the driving command
   avt_341::msg::Twist dc;
 
 	//make sure the path contains some points
-	int np = traj.poses.size();
+	const std::vector<utils::vec2> &path = tracker_.GetPoints();
+	const std::vector<float> &path_s = tracker_.GetArcLengths();
+	int np = path.size();
 
 	if (np < 2) return dc;
 
-	// extract the path that the vehicle needs to follow
-	std::vector<utils::vec2> path;
-
-	//populate the desired path
-	path.resize(np);
-	for (int i = 0; i < np; i++) {
-		path[i] = utils::vec2(traj.poses[i].pose.position.x, traj.poses[i].pose.position.y);
-	}
-
 	//calculate the lookahead distance based on current speed
 	utils::vec2 currpos(veh_x_, veh_y_);
 	float path_length = utils::length(path[np - 1] - currpos);
@@ -69,39 +72,27 @@ avt_341::msg::Twist PurePursuitController::GetDcFromTraj(avt_341::msg::Path traj
 	if (lookahead > path_length)lookahead = path_length - 0.01;
 
 	//first find the closest segment on the path , and distance to it
-	float closest = 1.0E9f;
-	int start_seg = 0;
-	for (int i = 0; i < np - 1; i++) {
-		float d0 = PointToSegmentDistance(path[i], path[i + 1], currpos);
-		if (d0 < closest) {
-			closest = d0;
-			start_seg = i;
-		}
-	}
+	tracker_.Update(currpos);
+	float closest = tracker_.GetTrackDistance();
+	int start_seg = tracker_.GetTrackIndex();
 
 	goal = path[start_seg];
 	float target_speed = desired_speed_;
 	utils::vec2 desired_direction;
 	if (closest < lookahead) {
-		//find point on path at lookahead distance away
-		float accum_dist = closest;
-
-		//for (int i=0;i<np-1;i++){
-		for (int i = start_seg; i < np - 1; i++) {
+		//find point on path at lookahead distance away, the first point
+		//whose arc length from the closest segment passes the remaining distance
+		float s_goal = path_s[start_seg] + lookahead - closest;
+		int i = (int)(std::upper_bound(path_s.begin() + start_seg + 1, path_s.end(), s_goal) - path_s.begin()) - 1;
+		if (i < np - 1) {
 			utils::vec2 v = path[i + 1] - path[i];
-			float seg_dist = length(v);
-			if ((accum_dist + seg_dist) > lookahead) {
-				utils::vec2 dir = v / seg_dist;
-				float t = lookahead - accum_dist;
-				goal = path[i] + dir*t;
-				desired_direction = v;
-				target_speed = desired_speed_; //traj.path[i + 1].speed;
-				if (target_speed > max_stable_speed_)target_speed = max_stable_speed_;
-				break;
-			}
-			else {
-				accum_dist += seg_dist;
-			}
+			float seg_dist = path_s[i + 1] - path_s[i];
+			utils::vec2 dir = v / seg_dist;
+			float t = s_goal - path_s[i];
+			goal = path[i] + dir*t;
+			desired_direction = v;
+			target_speed = desired_speed_; //traj.path[i + 1].speed;
+			if (target_speed > max_stable_speed_)target_speed = max_stable_speed_;
 		}
 	}
 
@@ -0,0 +1,107 @@
+#include "avt_341/control/state_predictor.h"
+#include "avt_341/avt_341_utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace avt_341 {
+namespace control{
+
+StatePredictor::StatePredictor() {
+	newest_ = 0;
+	count_ = 0;
+	for (int i = 0; i < buffer_size_; i++) {
+		stamps_[i] = 0.0;
+		speeds_[i] = 0.0f;
+	}
+	skid_steered_ = false;
+	wheelbase_ = 2.731f;
+	max_steering_angle_ = 0.69f;
+	steering_ = 0.0f;
+}
+
+void StatePredictor::AddOdometry(const avt_341::msg::Odometry &odom, double stamp) {
+	// Unstamped odometry can not be ordered, it replaces the newest entry and keeps
+	// its time, so the prediction always starts from the last message.
+	// Otherwise repeated messages are not added, so the buffer always spans distinct times.
+	if (count_ == 0 || stamp > 0.0) {
+		if (count_ > 0 && stamp <= stamps_[newest_]) return;
+		newest_ = (newest_ + 1) % buffer_size_;
+		stamps_[newest_] = stamp;
+		if (count_ < buffer_size_) count_++;
+	}
+	buffer_[newest_] = odom;
+	float vx = odom.twist.twist.linear.x;
+	float vy = odom.twist.twist.linear.y;
+	speeds_[newest_] = sqrtf(vx*vx + vy*vy);
+}
+
+avt_341::msg::Odometry StatePredictor::Predict(double dt) const {
+	avt_341::msg::Odometry state = buffer_[newest_];
+	if (count_ == 0 || dt <= 0.0) return state;
+
+	// acceleration between the oldest and the newest odometry in the buffer
+	int oldest = (newest_ - count_ + 1 + buffer_size_) % buffer_size_;
+	float accel = 0.0f;
+	double span = stamps_[newest_] - stamps_[oldest];
+	if (count_ > 1 && span > 0.0) {
+		accel = (float)((speeds_[newest_] - speeds_[oldest]) / span);
+		accel = std::max(-5.0f, std::min(5.0f, accel));
+	}
+
+	// distance traveled, stopping at zero speed
+	float v0 = speeds_[newest_];
+	float t = (float)dt;
+	if (accel < 0.0f) t = std::min(t, -v0 / accel);
+	float s = v0*t + 0.5f*accel*t*t;
+	float v1 = std::max(0.0f, v0 + accel*(float)dt);
+
+	float theta0 = utils::GetHeadingFromOrientation(state.pose.pose.orientation);
+	float dtheta;
+	float dx, dy;
+	if (skid_steered_) {
+		// constant measured yaw rate, moving along the mean heading
+		dtheta = (float)(state.twist.twist.angular.z*dt);
+		dx = s*cosf(theta0 + 0.5f*dtheta);
+		dy = s*sinf(theta0 + 0.5f*dtheta);
+	}
+	else {
+		// the bicycle model follows an arc of constant curvature for a constant steering angle
+		float curvature = tanf(steering_*max_steering_angle_) / wheelbase_;
+		dtheta = curvature*s;
+		if (fabs(dtheta) < 1.0E-4f) {
+			dx = s*cosf(theta0);
+			dy = s*sinf(theta0);
+		}
+		else {
+			dx = (sinf(theta0 + dtheta) - sinf(theta0)) / curvature;
+			dy = (cosf(theta0) - cosf(theta0 + dtheta)) / curvature;
+		}
+	}
+	state.pose.pose.position.x += dx;
+	state.pose.pose.position.y += dy;
+
+	// rotate the orientation about the vertical axis, keeping roll and pitch
+	double qz = sin(0.5*dtheta);
+	double qw = cos(0.5*dtheta);
+	avt_341::msg::Quaternion q = state.pose.pose.orientation;
+	state.pose.pose.orientation.x = qw*q.x - qz*q.y;
+	state.pose.pose.orientation.y = qw*q.y + qz*q.x;
+	state.pose.pose.orientation.z = qw*q.z + qz*q.w;
+	state.pose.pose.orientation.w = qw*q.w - qz*q.z;
+
+	// the velocity keeps its direction relative to the vehicle
+	float theta1 = theta0 + dtheta;
+	float scale = v0 > 0.0f ? v1 / v0 : 0.0f;
+	double vx = state.twist.twist.linear.x;
+	double vy = state.twist.twist.linear.y;
+	state.twist.twist.linear.x = scale*(cos(dtheta)*vx - sin(dtheta)*vy);
+	state.twist.twist.linear.y = scale*(sin(dtheta)*vx + cos(dtheta)*vy);
+	if (v0 <= 0.0f && v1 > 0.0f) {
+		state.twist.twist.linear.x = v1*cosf(theta1);
+		state.twist.twist.linear.y = v1*sinf(theta1);
+	}
+	return state;
+}
+
+} // namespace control
+} // namespace avt_341
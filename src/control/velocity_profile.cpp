@@ -0,0 +1,63 @@
+#include "avt_341/control/velocity_profile.h"
+#include "avt_341/avt_341_utils.h"
+#include <algorithm>
+#include <cmath>
+
+namespace avt_341 {
+namespace control{
+
+VelocityProfile::VelocityProfile() {
+	max_speed_ = 5.0f;
+	max_lateral_g_ = 0.75f;
+	max_accel_ = 1.0f;
+	max_decel_ = 2.0f;
+}
+
+void VelocityProfile::SetLimits(float max_speed, float max_lateral_g, float max_accel, float max_decel) {
+	max_speed_ = max_speed;
+	max_lateral_g_ = max_lateral_g;
+	max_accel_ = max_accel;
+	max_decel_ = max_decel;
+}
+
+void VelocityProfile::Compute(const avt_341::msg::Path &path) {
+	int np = path.poses.size();
+	speed_.assign(np, max_speed_);
+	ds_.assign(np, 0.0f);
+	for (int i = 1; i < np; i++) {
+		float dx = path.poses[i].pose.position.x - path.poses[i - 1].pose.position.x;
+		float dy = path.poses[i].pose.position.y - path.poses[i - 1].pose.position.y;
+		ds_[i] = sqrtf(dx*dx + dy*dy);
+	}
+
+	// Menger curvature of each interior point and its lateral acceleration limit
+	for (int i = 1; i < np - 1; i++) {
+		const avt_341::msg::Point &a = path.poses[i - 1].pose.position;
+		const avt_341::msg::Point &b = path.poses[i].pose.position;
+		const avt_341::msg::Point &c = path.poses[i + 1].pose.position;
+		float curvature = (float)fabs(utils::MengerCurvature(utils::vec2(a.x, a.y), utils::vec2(b.x, b.y), utils::vec2(c.x, c.y)));
+		if (curvature > 0.0f) speed_[i] = std::min(speed_[i], sqrtf(9.806f*max_lateral_g_ / curvature));
+	}
+	// the end points take the limit of their neighbor
+	if (np > 2) {
+		speed_[0] = speed_[1];
+		speed_[np - 1] = speed_[np - 2];
+	}
+
+	// accelerate out of and brake into the slow points
+	for (int i = 1; i < np; i++) {
+		speed_[i] = std::min(speed_[i], sqrtf(speed_[i - 1] * speed_[i - 1] + 2.0f*max_accel_*ds_[i]));
+	}
+	for (int i = np - 2; i >= 0; i--) {
+		speed_[i] = std::min(speed_[i], sqrtf(speed_[i + 1] * speed_[i + 1] + 2.0f*max_decel_*ds_[i + 1]));
+	}
+}
+
+float VelocityProfile::GetSpeed(int index) const {
+	if (speed_.size() == 0) return max_speed_;
+	index = std::max(0, std::min((int)speed_.size() - 1, index));
+	return speed_[index];
+}
+
+} // namespace control
+} // namespace avt_341
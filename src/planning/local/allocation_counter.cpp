@@ -0,0 +1,45 @@
+#include "avt_341/planning/local/allocation_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// The replacements live in their own translation unit, so they are not inlined
+// where the compiler pairs its own operator new with the free below.
+static std::atomic<unsigned long> num_allocations(0);
+
+void *operator new(std::size_t size){
+	num_allocations++;
+	void *p = std::malloc(size > 0 ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](std::size_t size){
+	return operator new(size);
+}
+
+void operator delete(void *p) noexcept{
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept{
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept{
+	std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept{
+	std::free(p);
+}
+
+namespace avt_341 {
+namespace planning{
+
+unsigned long GetNumAllocations() {
+	return num_allocations;
+}
+
+} // namespace planning
+} // namespace avt_341
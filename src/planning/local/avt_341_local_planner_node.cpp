@@ -14,16 +14,24 @@
 // avt_341 includes
 #include "avt_341/planning/local/spline_planner.h"
 #include "avt_341/planning/local/spline_plotter.h"
+#include "avt_341/planning/local/planner_recording.h"
 #include "avt_341/visualization/visualization_factory.h"
+#include <chrono>
+#include <string>
+#include <fstream>
 
 avt_341::msg::Odometry odom;
-avt_341::msg::OccupancyGrid grid;
-avt_341::msg::OccupancyGrid segmentation_grid;
+// grids are shared with the planner instead of being copied each cycle
+avt_341::msg::OccupancyGridConstPtr grid;
+avt_341::msg::OccupancyGridConstPtr segmentation_grid;
 avt_341::msg::Path global_path;
 avt_341::msg::Path waypoints;
 bool odom_rcvd = false;
 bool new_grid_rcvd = false;
 bool new_seg_grid_rcvd = false;
+// tracked objects as received, flattened [x, y, vx, vy, radius] per object
+std::vector<double> tracked_objects;
+bool new_objects_rcvd = false;
 
 void OdometryCallback(avt_341::msg::OdometryPtr rcv_odom){
   odom = *rcv_odom;
@@ -31,12 +39,12 @@ void OdometryCallback(avt_341::msg::OdometryPtr rcv_odom){
 }
 
 void GridCallback(avt_341::msg::OccupancyGridPtr rcv_grid){
-  grid = *rcv_grid;
+  grid = rcv_grid;
   new_grid_rcvd = true;
 }
 
 void SegmentationGridCallback(avt_341::msg::OccupancyGridPtr rcv_grid){
-    segmentation_grid = *rcv_grid;
+    segmentation_grid = rcv_grid;
     new_seg_grid_rcvd = true;
 }
 
@@ -48,25 +56,64 @@ void WaypointCallback(avt_341::msg::PathPtr wp_path){
   waypoints = *wp_path;
 }
 
+void TrackedObjectsCallback(avt_341::msg::Float64MultiArrayPtr rcv_objects){
+  tracked_objects = rcv_objects->data;
+  new_objects_rcvd = true;
+}
+
+// stage timing percentiles in milliseconds and the number of cycles that took longer than the rate allows
+avt_341::msg::DiagnosticArray TimingDiagnostics(avt_341::planning::StageTimingStats &timing, unsigned int overruns, bool new_overruns){
+  avt_341::msg::DiagnosticStatus status;
+  status.name = "avt_341_local_planner timing";
+  status.hardware_id = "avt_341";
+  status.level = new_overruns ? avt_341::msg::DiagnosticStatus::WARN : avt_341::msg::DiagnosticStatus::OK;
+  status.message = new_overruns ? "planning cycles overran the rate" : "ok";
+  for (int i = 0; i < avt_341::planning::NUM_PLANNER_STAGES; i++){
+    avt_341::planning::StagePercentiles p = timing.Percentiles(i);
+    if (p.count == 0) continue;
+    std::string stage = avt_341::planning::StageTimingStats::StageName(i);
+    const char *suffixes[4] = {"/p50_ms", "/p95_ms", "/p99_ms", "/max_ms"};
+    double values[4] = {p.p50, p.p95, p.p99, p.max};
+    for (int j = 0; j < 4; j++){
+      avt_341::msg::KeyValue kv;
+      kv.key = stage + suffixes[j];
+      kv.value = std::to_string(1000.0 * values[j]);
+      status.values.push_back(kv);
+    }
+  }
+  avt_341::msg::KeyValue kv;
+  kv.key = "overruns";
+  kv.value = std::to_string(overruns);
+  status.values.push_back(kv);
+  avt_341::msg::DiagnosticArray diagnostics;
+  diagnostics.status.push_back(status);
+  return diagnostics;
+}
+
 int main(int argc, char *argv[]){
 
   auto n = avt_341::node::init_node(argc, argv, "avt_341_planner_node");
 
   // Create publishers and subscribers
   auto path_pub = n->create_publisher<avt_341::msg::Path>("avt_341/local_path", 10);
+  auto diagnostics_pub = n->create_publisher<avt_341::msg::DiagnosticArray>("/diagnostics", 10);
   auto odometry_sub = n->create_subscription<avt_341::msg::Odometry>("avt_341/odometry", 10, OdometryCallback);
   auto grid_sub = n->create_subscription<avt_341::msg::OccupancyGrid>("avt_341/occupancy_grid", 10, GridCallback);
   auto segmentation_grid_sub = n->create_subscription<avt_341::msg::OccupancyGrid>("avt_341/segmentation_grid", 10, SegmentationGridCallback);
   auto path_sub = n->create_subscription<avt_341::msg::Path>("avt_341/global_path", 10, PathCallback);
   auto wp_sub = n->create_subscription<avt_341::msg::Path>("avt_341/waypoints", 10, WaypointCallback);
+  auto objects_sub = n->create_subscription<avt_341::msg::Float64MultiArray>("avt_341/tracked_objects", 10, TrackedObjectsCallback);
 
   avt_341::planning::Planner planner;
   // planner params
   float path_look_ahead, vehicle_width, max_steer_angle, output_path_step, path_int_step, rate;
-  int dilation_factor, num_paths;
+  int dilation_factor, num_paths, adaptive_coarse_paths, adaptive_eval_budget, num_horizons, planner_threads, template_cache_size, warm_start_refresh_cycles;
   float w_c, w_d, w_s, w_r, w_t, cost_vis_text_size, ignore_coll_before_dist;
-  bool trim_path, use_global_path, use_blend;
-  std::string display, cost_vis;
+  float collision_radius, clearance_cost_dist, vehicle_length, template_rho_quantum, template_theta_quantum;
+  float dynamic_vehicle_radius, dynamic_cost_dist, dynamic_time_horizon, tracked_object_timeout;
+  float warm_start_pose_delta, warm_start_heading_delta;
+  bool trim_path, use_global_path, use_blend, prune_candidates;
+  std::string display, cost_vis, record_inputs;
 
   n->get_parameter("~path_look_ahead", path_look_ahead, 15.0f);
   n->get_parameter("~vehicle_width", vehicle_width, 3.0f);
@@ -82,12 +129,31 @@ int main(int argc, char *argv[]){
   n->get_parameter("~w_t", w_t, 0.0f);
   n->get_parameter("~rate", rate, 50.0f);
   n->get_parameter("~ignore_coll_before_dist", ignore_coll_before_dist, 0.0f);
+  n->get_parameter("~collision_radius", collision_radius, 0.0f);
+  n->get_parameter("~clearance_cost_dist", clearance_cost_dist, 0.0f);
+  n->get_parameter("~vehicle_length", vehicle_length, 0.0f);
   n->get_parameter("~trim_path", trim_path, false);
   n->get_parameter("~use_global_path", use_global_path, false);
   n->get_parameter("~use_blend", use_blend, true);
+  n->get_parameter("~prune_candidates", prune_candidates, true);
+  n->get_parameter("~adaptive_coarse_paths", adaptive_coarse_paths, 0);
+  n->get_parameter("~adaptive_eval_budget", adaptive_eval_budget, 40);
+  n->get_parameter("~num_horizons", num_horizons, 1);
+  n->get_parameter("~planner_threads", planner_threads, 1);
+  n->get_parameter("~template_cache_size", template_cache_size, 0);
+  n->get_parameter("~template_rho_quantum", template_rho_quantum, 0.02f);
+  n->get_parameter("~template_theta_quantum", template_theta_quantum, 0.005f);
+  n->get_parameter("~dynamic_vehicle_radius", dynamic_vehicle_radius, 0.0f);
+  n->get_parameter("~dynamic_cost_dist", dynamic_cost_dist, 2.0f);
+  n->get_parameter("~dynamic_time_horizon", dynamic_time_horizon, 5.0f);
+  n->get_parameter("~tracked_object_timeout", tracked_object_timeout, 1.0f);
+  n->get_parameter("~warm_start_pose_delta", warm_start_pose_delta, 0.0f);
+  n->get_parameter("~warm_start_heading_delta", warm_start_heading_delta, 0.02f);
+  n->get_parameter("~warm_start_refresh_cycles", warm_start_refresh_cycles, 10);
   n->get_parameter("~cost_vis", cost_vis, std::string("final"));
   n->get_parameter("~cost_vis_text_size", cost_vis_text_size, 2.0f);
   n->get_parameter("~display", display, avt_341::visualization::default_display);
+  n->get_parameter("~record_inputs", record_inputs, std::string(""));
 
   planner.SetArcLengthIntegrationStep(path_int_step);
   planner.SetComfortabilityWeight(w_c);
@@ -96,58 +162,127 @@ int main(int argc, char *argv[]){
   planner.SetPathAdherenceWeight(w_r);
   planner.SetSegmentationFactorWeight(w_t);
   planner.SetUseBlend(use_blend);
+  planner.SetUseCandidatePruning(prune_candidates);
+  planner.SetAdaptiveSampling(adaptive_coarse_paths, adaptive_eval_budget);
+  planner.SetNumHorizons(num_horizons);
+  planner.SetNumThreads(planner_threads);
+  planner.SetTemplateCache(template_cache_size, template_rho_quantum, template_theta_quantum);
+  // by default the vehicle disk checked against moving obstacles is half the vehicle width
+  planner.SetDynamicObstacleParams(dynamic_vehicle_radius > 0.0f ? dynamic_vehicle_radius : 0.5f*vehicle_width, dynamic_cost_dist, dynamic_time_horizon);
+  planner.SetWarmStart(warm_start_pose_delta, warm_start_heading_delta, warm_start_refresh_cycles);
   planner.SetIgnoreCollBeforeDist(ignore_coll_before_dist);
+  planner.SetCollisionRadius(collision_radius);
+  planner.SetClearanceCostDistance(clearance_cost_dist);
+  planner.SetVehicleFootprint(vehicle_length, vehicle_width);
 
   std::shared_ptr<avt_341::planning::Plotter> plotter = avt_341::visualization::create_local_path_plotter(display, cost_vis, n,
                                                                                                           planner.GetComfortabilityWeight(), planner.GetStaticSafetyWeight(),
                                                                                                           planner.GetPathAdherenceWeight(), planner.GetDynamicSafetyWeight(),
                                                                                                           cost_vis_text_size);
 
+  // The centerline is cached and only rebuilt when the source path changes, or when a trimmed
+  // path has to be extended. A trimmed path is built from the poses [window_begin, window_end)
+  // of the source, which reach twice the trimming distance ahead of the vehicle, and it is
+  // extended when the vehicle gets within the trimming distance of its last pose.
+  // The window is advanced from the previous one, so the source is only scanned from its
+  // first pose when it changes or when the vehicle is away from all of it.
+  avt_341::planning::Path path;
+  bool path_valid = false;
+  bool path_from_global = false;
+  unsigned int path_seq = 0;
+  double path_stamp = 0.0;
+  int window_begin = 0;
+  int window_end = 0;
+  double objects_time = 0.0;
+
+  // inputs of every cycle are appended to this file for avt_341_planner_benchmark
+  std::ofstream recording;
+  if (record_inputs != "") recording.open(record_inputs.c_str());
+
+  // the stages are timed when built with AVT_341_TIMING, the whole cycle always is
+  avt_341::planning::StageTimingStats timing;
+  planner.SetTimingStats(&timing);
+  unsigned int overruns = 0;
+  unsigned int reported_overruns = 0;
+  std::chrono::steady_clock::time_point last_diagnostics = std::chrono::steady_clock::now();
+
   unsigned int loop_count = 0;
   float dt = 1.0f / rate;
   float elapsed_time = 0.0f;
   avt_341::node::Rate rosrate(rate);
   while (avt_341::node::ok()){
-    double start_secs = n->get_now_seconds();
-    if (global_path.poses.size() > 0 && odom_rcvd && grid.data.size() > 0){
+    std::chrono::steady_clock::time_point cycle_start = std::chrono::steady_clock::now();
+    if (global_path.poses.size() > 0 && odom_rcvd && grid && grid->data.size() > 0){
 
-      std::vector<avt_341::utils::vec2> path_points;
-      if (use_global_path){
-        for (int i = 0; i < global_path.poses.size(); i++){
-          avt_341::utils::vec2 point(global_path.poses[i].pose.position.x, global_path.poses[i].pose.position.y);
-          path_points.push_back(point);
-        }
+      const avt_341::msg::Path &source = use_global_path ? global_path : waypoints;
+      avt_341::utils::vec2 current_pos(odom.pose.pose.position.x, odom.pose.pose.position.y);
+      int num_poses = (int)source.poses.size();
+      bool new_source = !path_valid || path_from_global != use_global_path ||
+        avt_341::node::get_seq(source.header) != path_seq ||
+        avt_341::node::seconds_from_header(source.header) != path_stamp;
+      bool rebuild_path = new_source;
+
+      bool trim = trim_path && use_global_path;
+      float trim_dist = 1.5f * path_look_ahead;
+      auto dist_to_pose = [&](int i) {
+        avt_341::utils::vec2 point(source.poses[i].pose.position.x, source.poses[i].pose.position.y);
+        return avt_341::utils::length(current_pos - point);
+      };
+      if (trim && !rebuild_path){
+        // an empty window is searched again, otherwise it is extended before the vehicle nears its end
+        if (window_begin >= window_end) rebuild_path = true;
+        else if (window_end < num_poses && dist_to_pose(window_end - 1) < trim_dist) rebuild_path = true;
+      }
+
+      avt_341::utils::vec2 srho;
+      if (!rebuild_path){
+        // the vehicle must still be past the beginning of the cached path
+        srho = path.ToSRho(odom.pose.pose.position.x, odom.pose.pose.position.y);
+        if (srho.x <= 0.0f) rebuild_path = true;
       }
-      else{
-        for (int i = 0; i < waypoints.poses.size(); i++){
-          avt_341::utils::vec2 point(waypoints.poses[i].pose.position.x, waypoints.poses[i].pose.position.y);
+      if (rebuild_path){
+        AVT_341_SCOPED_TIMER(&timing, avt_341::planning::STAGE_PATH);
+        if (!trim){
+          window_begin = 0;
+          window_end = num_poses;
+        }
+        else {
+          if (new_source || window_begin >= window_end){
+            window_begin = 0;
+            window_end = 0;
+          }
+          // drop the poses before the first one within the trimming distance,
+          // and keep the poses after it up to twice the distance
+          while (window_begin < num_poses && dist_to_pose(window_begin) >= trim_dist) window_begin++;
+          window_end = std::max(window_end, window_begin);
+          while (window_end < num_poses && dist_to_pose(window_end) < 2.0f * trim_dist) window_end++;
+        }
+        std::vector<avt_341::utils::vec2> path_points;
+        for (int i = window_begin; i < window_end; i++){
+          avt_341::utils::vec2 point(source.poses[i].pose.position.x, source.poses[i].pose.position.y);
           path_points.push_back(point);
         }
-        
-      }
-      avt_341::planning::Path path;
-      if (trim_path && use_global_path ){
-        avt_341::utils::vec2 current_pos(odom.pose.pose.position.x, odom.pose.pose.position.y);
-        path.Init(path_points, current_pos, 1.5f * path_look_ahead);
-      }
-      else{
         path.Init(path_points);
+        path.FixBeginning(odom.pose.pose.position.x, odom.pose.pose.position.y);
+        planner.SetCenterline(path);
+        srho = path.ToSRho(odom.pose.pose.position.x, odom.pose.pose.position.y);
+        path_valid = true;
+        path_from_global = use_global_path;
+        path_seq = avt_341::node::get_seq(source.header);
+        path_stamp = avt_341::node::seconds_from_header(source.header);
       }
 
-      path.FixBeginning(odom.pose.pose.position.x, odom.pose.pose.position.y);
-
-      std::vector<avt_341::utils::vec2> culled_points = path.GetPoints();
       float s_max = path.GetTotalLength();
-      avt_341::utils::vec2 srho = path.ToSRho(odom.pose.pose.position.x, odom.pose.pose.position.y);
       float s = srho.x;
       float rho_start = srho.y;
-      avt_341::utils::vec2 pconv = path.ToCartesian(s,rho_start);
       float s_lookahead = std::min(path_look_ahead, s_max - s);
       float theta = avt_341::utils::GetHeadingFromOrientation(odom.pose.pose.orientation);
       avt_341::planning::CurveInfo ci = path.GetCurvatureAndAngle(s);
 
-      planner.GeneratePaths(num_paths, s, rho_start, theta - ci.theta, s_lookahead, max_steer_angle, vehicle_width);
-      planner.SetCenterline(path);
+      {
+        AVT_341_SCOPED_TIMER(&timing, avt_341::planning::STAGE_GENERATE_PATHS);
+        planner.GeneratePaths(num_paths, s, rho_start, theta - ci.theta, s_lookahead, max_steer_angle, vehicle_width);
+      }
   
       // calculate bounds around the vehicle to limit grid dilation to space 10m behind and path_look_ahead distance in front of the vehicle
       float veh_heading_x = cos(theta);
@@ -169,15 +304,63 @@ int main(int argc, char *argv[]){
       float urx = std::max({lf_bounds_x, rf_bounds_x, lr_bounds_x, rr_bounds_x});
       float ury = std::max({lf_bounds_y, rf_bounds_y, lr_bounds_y, rr_bounds_y});
 
-      if (new_grid_rcvd) planner.DilateGrid(grid, dilation_factor, llx, lly, urx, ury);
-      if (new_seg_grid_rcvd) planner.DilateGrid(segmentation_grid, dilation_factor, llx, lly, urx, ury);
+      // the recording only stores a grid in the cycle it is used first
+      bool grid_changed = new_grid_rcvd;
+      bool seg_grid_changed = new_seg_grid_rcvd;
+      if (new_grid_rcvd){
+        AVT_341_SCOPED_TIMER(&timing, avt_341::planning::STAGE_DILATE_GRID);
+        planner.SetGrid(grid);
+        planner.DilateGrid(dilation_factor, llx, lly, urx, ury);
+        new_grid_rcvd = false;
+      }
+      if (new_seg_grid_rcvd){
+        AVT_341_SCOPED_TIMER(&timing, avt_341::planning::STAGE_DILATE_GRID);
+        planner.SetSegmentationGrid(segmentation_grid);
+        planner.DilateSegmentationGrid(dilation_factor, llx, lly, urx, ury);
+        new_seg_grid_rcvd = false;
+      }
       // Note: if grid size gets large, DilateGrid can take a significant amount of time
 
+      // tracked objects are moved to the current time, and dropped if no update came for too long
+      double now = n->get_now_seconds();
+      if (new_objects_rcvd){
+        objects_time = now;
+        new_objects_rcvd = false;
+      }
+      std::vector<avt_341::planning::DynamicObstacle> obstacles;
+      float objects_age = (float)(now - objects_time);
+      if (objects_age <= tracked_object_timeout){
+        for (size_t i = 0; i + 4 < tracked_objects.size(); i += 5){
+          avt_341::planning::DynamicObstacle obstacle;
+          obstacle.vx = (float)tracked_objects[i + 2];
+          obstacle.vy = (float)tracked_objects[i + 3];
+          obstacle.x = (float)tracked_objects[i] + obstacle.vx*objects_age;
+          obstacle.y = (float)tracked_objects[i + 1] + obstacle.vy*objects_age;
+          obstacle.radius = (float)tracked_objects[i + 4];
+          obstacles.push_back(obstacle);
+        }
+      }
+      planner.SetDynamicObstacles(obstacles);
+
+      if (recording.is_open()){
+        avt_341::planning::PlannerInput input;
+        input.new_grid = grid_changed;
+        if (grid_changed) input.grid = *grid;
+        input.new_segmentation_grid = seg_grid_changed;
+        if (seg_grid_changed && segmentation_grid) input.segmentation_grid = *segmentation_grid;
+        input.odom = odom;
+        input.path = source;
+        avt_341::planning::WritePlannerInput(recording, input);
+      }
+
       // most of the calculation time spent on this function call
-      bool path_found = planner.CalculateCandidateCosts(grid, segmentation_grid, odom);
+      bool path_found = planner.CalculateCandidateCosts(odom);
+      // display and publishing are timed to the end of the cycle
+      AVT_341_SCOPED_TIMER(&timing, avt_341::planning::STAGE_PUBLISH);
       if (display != "none"){
-        plotter->AddMap(grid);
-        plotter->SetPath(culled_points);
+        // the dilated grid the candidates were checked against
+        if (!planner.GetGrid().Empty()) plotter->AddMap(planner.GetGrid());
+        plotter->SetPath(path.GetPoints());
         plotter->AddWaypoints(waypoints);
         std::vector<avt_341::planning::Candidate> paths = planner.GetCandidates();
         plotter->AddCurves(paths);
@@ -225,16 +408,21 @@ int main(int argc, char *argv[]){
       else if (!odom_rcvd){
         //std::cout << "Local planner did not run because vehicle odometry not recieved." << std::endl;
       }
-      else if (grid.data.size() <= 0){
+      else if (!grid || grid->data.size() <= 0){
         //std::cout << "Local planner did not run because occupancy grid not recieved." << std::endl;
       }
     }
-    new_grid_rcvd = false;
-    new_seg_grid_rcvd = false;
     loop_count++;
-    double end_secs = n->get_now_seconds();
-    if ((end_secs - start_secs) > 2.5 * dt){
-      //std::cout << "WARNING: TANG PLANNER TOOK " << (end_secs - start_secs) << " TO COMPLETE. REQUESTED UPDATE SPEED IS " << dt << std::endl;
+    std::chrono::steady_clock::time_point cycle_end = std::chrono::steady_clock::now();
+    double cycle_time = std::chrono::duration<double>(cycle_end - cycle_start).count();
+    timing.Add(avt_341::planning::STAGE_CYCLE, cycle_time);
+    if (cycle_time > dt) overruns++;
+    if (std::chrono::duration<double>(cycle_end - last_diagnostics).count() >= 1.0){
+      avt_341::msg::DiagnosticArray diagnostics = TimingDiagnostics(timing, overruns, overruns > reported_overruns);
+      diagnostics.header.stamp = n->get_stamp();
+      diagnostics_pub->publish(diagnostics);
+      reported_overruns = overruns;
+      last_diagnostics = cycle_end;
     }
 
     n->spin_some();
@@ -61,17 +61,19 @@ int main(int argc, char *argv[]){
 
   // planner params
   float kp, eta, cutoff_dist, rate;
-  bool use_global_path;
+  bool use_global_path, gradient_descent;
   n->get_parameter("~kp", kp, 5.0f);
   n->get_parameter("~eta", eta, 100.0f);
   n->get_parameter("~cutoff_dist", cutoff_dist, 20.0f);
   n->get_parameter("~use_global_path", use_global_path, false);
+  n->get_parameter("~gradient_descent", gradient_descent, false);
   n->get_parameter("~rate", rate, 50.0f);
 
   avt_341::planning::PfPlanner planner;
   planner.SetEta(eta);
   planner.SetKp(kp);
   planner.SetCutoffDistance(cutoff_dist);
+  planner.SetUseGradientDescent(gradient_descent);
 
   unsigned int loop_count = 0;
   float dt = 1.0f / rate;
@@ -79,6 +81,10 @@ int main(int argc, char *argv[]){
   avt_341::node::Rate rosrate(rate);
   while (avt_341::node::ok()){
     double start_secs = n->get_now_seconds();
+    // the repulsive potential is only recomputed for new grids
+    if (new_grid_rcvd && grid.data.size() > 0){
+      planner.SetGrid(grid);
+    }
     if (global_path.poses.size() > 0 && odom_rcvd && grid.data.size() > 0){
 
       float gx, gy;
@@ -93,7 +99,7 @@ int main(int argc, char *argv[]){
 
       planner.SetGoal(gx, gy);
 
-      avt_341::msg::Path local_path = planner.Plan(grid, odom);
+      avt_341::msg::Path local_path = planner.Plan(odom);
 
       local_path.header.frame_id = "map";
       local_path.header.stamp = n->get_stamp();
@@ -0,0 +1,193 @@
+/**
+ * \file avt_341_planner_benchmark.cpp
+ * Replay recorded local planner inputs without ROS and time the planner cycle
+ * for several numbers of paths and arc length integration steps.
+ *
+ * Usage: avt_341_planner_benchmark recording [repetitions] [dilation_factor] [planner_threads] [num_horizons]
+ * The recording is written by the local planner node when ~record_inputs is set.
+ *
+ * \date 10/17/2026
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "avt_341/planning/local/spline_planner.h"
+#include "avt_341/planning/local/planner_recording.h"
+#include "avt_341/planning/local/allocation_counter.h"
+
+// same settings as the defaults of the local planner node
+const float path_look_ahead = 15.0f;
+const float vehicle_width = 3.0f;
+const float max_steer_angle = 0.43f;
+
+struct BenchmarkResult {
+  int cycles;
+  long candidates;
+  unsigned long allocations;
+  double generate_seconds;
+  double dilate_seconds;
+  double cost_seconds;
+};
+
+double SecondsSince(std::chrono::steady_clock::time_point start){
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+BenchmarkResult RunBenchmark(const std::vector<avt_341::planning::PlannerInput> &inputs,
+                             std::vector<avt_341::planning::Path> &paths, const std::vector<int> &path_index,
+                             int num_paths, float ds, int repetitions, int dilation_factor, int threads, int horizons){
+  // cycles that did not receive a grid share the grid of the cycle before
+  std::vector<avt_341::msg::OccupancyGridConstPtr> grids, segmentation_grids;
+  avt_341::msg::OccupancyGridConstPtr grid(new avt_341::msg::OccupancyGrid);
+  avt_341::msg::OccupancyGridConstPtr segmentation_grid(new avt_341::msg::OccupancyGrid);
+  for (int i = 0; i < (int)inputs.size(); i++){
+    if (inputs[i].new_grid) grid.reset(new avt_341::msg::OccupancyGrid(inputs[i].grid));
+    if (inputs[i].new_segmentation_grid) segmentation_grid.reset(new avt_341::msg::OccupancyGrid(inputs[i].segmentation_grid));
+    grids.push_back(grid);
+    segmentation_grids.push_back(segmentation_grid);
+  }
+
+  avt_341::planning::Planner planner;
+  planner.SetArcLengthIntegrationStep(ds);
+  planner.SetComfortabilityWeight(0.2f);
+  planner.SetDynamicSafetyWeight(0.2f);
+  planner.SetStaticSafetyWeight(0.2f);
+  planner.SetPathAdherenceWeight(0.4f);
+  planner.SetNumThreads(threads);
+  planner.SetNumHorizons(horizons);
+
+  BenchmarkResult result;
+  result.cycles = 0;
+  result.candidates = 0;
+  result.allocations = 0;
+  result.generate_seconds = 0.0;
+  result.dilate_seconds = 0.0;
+  result.cost_seconds = 0.0;
+
+  // the first pass over the recording is not measured
+  int current_path = -1;
+  avt_341::msg::OccupancyGridConstPtr current_grid, current_segmentation_grid;
+  for (int r = 0; r <= repetitions; r++){
+    for (int i = 0; i < (int)inputs.size(); i++){
+      const avt_341::msg::Odometry &odom = inputs[i].odom;
+      avt_341::planning::Path &path = paths[path_index[i]];
+      // every allocation of the process is counted, the planner should not allocate once warmed up
+      unsigned long allocations = avt_341::planning::GetNumAllocations();
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      // like the node, the centerline is only set when the source path changes
+      if (path_index[i] != current_path){
+        planner.SetCenterline(path);
+        current_path = path_index[i];
+      }
+      avt_341::utils::vec2 srho = path.ToSRho(odom.pose.pose.position.x, odom.pose.pose.position.y);
+      float s_lookahead = std::min(path_look_ahead, path.GetTotalLength() - srho.x);
+      float theta = avt_341::utils::GetHeadingFromOrientation(odom.pose.pose.orientation);
+      avt_341::planning::CurveInfo ci = path.GetCurvatureAndAngle(srho.x);
+      planner.GeneratePaths(num_paths, srho.x, srho.y, theta - ci.theta, s_lookahead, max_steer_angle, vehicle_width);
+      double generate_seconds = SecondsSince(start);
+
+      // dilation window of the node, 10m behind and path_look_ahead in front of the vehicle
+      start = std::chrono::steady_clock::now();
+      float hx = cos(theta);
+      float hy = sin(theta);
+      float llx = odom.pose.pose.position.x, lly = odom.pose.pose.position.y;
+      float urx = llx, ury = lly;
+      for (int c = 0; c < 4; c++){
+        float side = (c & 1) ? 0.5f*path_look_ahead : -0.5f*path_look_ahead;
+        float along = (c & 2) ? path_look_ahead : -10.0f;
+        float x = odom.pose.pose.position.x - hy*side + hx*along;
+        float y = odom.pose.pose.position.y + hx*side + hy*along;
+        llx = std::min(llx, x);
+        lly = std::min(lly, y);
+        urx = std::max(urx, x);
+        ury = std::max(ury, y);
+      }
+      // like the node, a grid is only set and dilated when it changes
+      if (grids[i] != current_grid){
+        planner.SetGrid(grids[i]);
+        planner.DilateGrid(dilation_factor, llx, lly, urx, ury);
+        current_grid = grids[i];
+      }
+      if (segmentation_grids[i] != current_segmentation_grid && segmentation_grids[i]->data.size() > 0){
+        planner.SetSegmentationGrid(segmentation_grids[i]);
+        planner.DilateSegmentationGrid(dilation_factor, llx, lly, urx, ury);
+        current_segmentation_grid = segmentation_grids[i];
+      }
+      double dilate_seconds = SecondsSince(start);
+
+      start = std::chrono::steady_clock::now();
+      planner.CalculateCandidateCosts(odom);
+      double cost_seconds = SecondsSince(start);
+      allocations = avt_341::planning::GetNumAllocations() - allocations;
+
+      if (r == 0) continue;
+      result.cycles++;
+      result.candidates += planner.GetCandidates().size();
+      result.allocations += allocations;
+      result.generate_seconds += generate_seconds;
+      result.dilate_seconds += dilate_seconds;
+      result.cost_seconds += cost_seconds;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]){
+  if (argc < 2){
+    printf("Usage: %s recording [repetitions] [dilation_factor] [planner_threads] [num_horizons]\n", argv[0]);
+    return 1;
+  }
+  int repetitions = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+  int dilation_factor = argc > 3 ? atoi(argv[3]) : 0;
+  int threads = argc > 4 ? atoi(argv[4]) : 1;
+  int horizons = argc > 5 ? atoi(argv[5]) : 1;
+
+  std::vector<avt_341::planning::PlannerInput> inputs;
+  if (!avt_341::planning::ReadPlannerInputs(argv[1], inputs) || inputs.size() == 0){
+    printf("Could not read planner inputs from %s\n", argv[1]);
+    return 1;
+  }
+
+  // consecutive cycles with the same source path share a centerline
+  std::vector<avt_341::planning::Path> paths;
+  std::vector<int> path_index;
+  for (int i = 0; i < (int)inputs.size(); i++){
+    const avt_341::msg::Path &source = inputs[i].path;
+    bool same = i > 0 && source.poses.size() == inputs[i - 1].path.poses.size();
+    for (int j = 0; same && j < (int)source.poses.size(); j++){
+      same = source.poses[j].pose.position.x == inputs[i - 1].path.poses[j].pose.position.x &&
+             source.poses[j].pose.position.y == inputs[i - 1].path.poses[j].pose.position.y;
+    }
+    if (!same){
+      std::vector<avt_341::utils::vec2> points;
+      for (int j = 0; j < (int)source.poses.size(); j++){
+        points.push_back(avt_341::utils::vec2(source.poses[j].pose.position.x, source.poses[j].pose.position.y));
+      }
+      avt_341::planning::Path path;
+      path.Init(points);
+      path.FixBeginning(inputs[i].odom.pose.pose.position.x, inputs[i].odom.pose.pose.position.y);
+      paths.push_back(path);
+    }
+    path_index.push_back((int)paths.size() - 1);
+  }
+
+  printf("%d recorded cycles, %d paths, %d repetitions, dilation %d, %d threads, %d horizons\n",
+         (int)inputs.size(), (int)paths.size(), repetitions, dilation_factor, threads, horizons);
+  printf("%9s %6s %12s %14s %12s %12s %12s %14s\n", "num_paths", "ds", "cycles/sec", "ns/candidate",
+         "generate_ms", "dilate_ms", "costs_ms", "allocs/cycle");
+  const int num_paths_settings[3] = {15, 31, 61};
+  const float ds_settings[3] = {0.5f, 0.25f, 0.1f};
+  for (int i = 0; i < 3; i++){
+    for (int j = 0; j < 3; j++){
+      BenchmarkResult r = RunBenchmark(inputs, paths, path_index, num_paths_settings[i], ds_settings[j],
+                                       repetitions, dilation_factor, threads, horizons);
+      double total = r.generate_seconds + r.dilate_seconds + r.cost_seconds;
+      printf("%9d %6.2f %12.1f %14.1f %12.4f %12.4f %12.4f %14.1f\n", num_paths_settings[i], ds_settings[j],
+             r.cycles / total, 1.0e9 * total / std::max(1L, r.candidates),
+             1.0e3 * r.generate_seconds / r.cycles, 1.0e3 * r.dilate_seconds / r.cycles,
+             1.0e3 * r.cost_seconds / r.cycles, (double)r.allocations / r.cycles);
+    }
+  }
+  return 0;
+}
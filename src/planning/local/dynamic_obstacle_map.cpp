@@ -0,0 +1,114 @@
+#include "avt_341/planning/local/dynamic_obstacle_map.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace avt_341 {
+namespace planning{
+
+DynamicObstacleMap::DynamicObstacleMap() {
+	influence_ = 0.0f;
+	horizon_ = 0.0f;
+	slice_dt_ = 1.0f;
+	cell_size_ = 1.0f;
+	max_speed_ = 0.0f;
+	num_slices_ = 0;
+	bucket_mask_ = 0;
+}
+
+void DynamicObstacleMap::SetObstacles(const std::vector<DynamicObstacle> &obstacles) {
+	obstacles_ = obstacles;
+	max_speed_ = 0.0f;
+	for (int i = 0; i < (int)obstacles_.size(); i++) {
+		max_speed_ = std::max(max_speed_, sqrtf(obstacles_[i].vx*obstacles_[i].vx + obstacles_[i].vy*obstacles_[i].vy));
+	}
+	start_.clear();
+	entries_.clear();
+	num_slices_ = 0;
+}
+
+int DynamicObstacleMap::Bucket(int ix, int iy, int slice) const {
+	unsigned int h = ((unsigned int)ix * 73856093u) ^ ((unsigned int)iy * 19349663u) ^ ((unsigned int)slice * 83492791u);
+	return (int)(h & (unsigned int)bucket_mask_);
+}
+
+void DynamicObstacleMap::Build(float influence, float horizon, float slice_dt, float cell_size) {
+	influence_ = std::max(0.0f, influence);
+	horizon_ = std::max(0.0f, horizon);
+	slice_dt_ = slice_dt > 0.0f ? slice_dt : std::max(horizon_, 1.0f);
+	cell_size_ = cell_size > 0.0f ? cell_size : 1.0f;
+	num_slices_ = (int)ceilf(horizon_ / slice_dt_) + 1;
+	const float inv_cell = 1.0f / cell_size_;
+
+	// slice k holds the times [k-0.5, k+0.5]*slice_dt, an obstacle is inserted in
+	// every cell of the bounding box of its disk, grown by the influence distance, over that interval
+	struct CellRange {
+		int ix0, iy0, ix1, iy1;
+	};
+	std::vector<CellRange> ranges(obstacles_.size() * num_slices_);
+	int total = 0;
+	for (int i = 0; i < (int)obstacles_.size(); i++) {
+		const DynamicObstacle &o = obstacles_[i];
+		float r = o.radius + influence_;
+		for (int k = 0; k < num_slices_; k++) {
+			float ta = std::max(0.0f, (k - 0.5f) * slice_dt_);
+			float tb = std::min(horizon_, (k + 0.5f) * slice_dt_);
+			float xa = o.x + o.vx*ta;
+			float xb = o.x + o.vx*tb;
+			float ya = o.y + o.vy*ta;
+			float yb = o.y + o.vy*tb;
+			CellRange &cr = ranges[i * num_slices_ + k];
+			cr.ix0 = (int)floorf((std::min(xa, xb) - r) * inv_cell);
+			cr.ix1 = (int)floorf((std::max(xa, xb) + r) * inv_cell);
+			cr.iy0 = (int)floorf((std::min(ya, yb) - r) * inv_cell);
+			cr.iy1 = (int)floorf((std::max(ya, yb) + r) * inv_cell);
+			total += (cr.ix1 - cr.ix0 + 1) * (cr.iy1 - cr.iy0 + 1);
+		}
+	}
+	int num_buckets = 16;
+	while (num_buckets < total) num_buckets *= 2;
+	bucket_mask_ = num_buckets - 1;
+
+	// count, prefix sum and fill
+	start_.assign(num_buckets + 1, 0);
+	for (int i = 0; i < (int)obstacles_.size(); i++) {
+		for (int k = 0; k < num_slices_; k++) {
+			const CellRange &cr = ranges[i * num_slices_ + k];
+			for (int ix = cr.ix0; ix <= cr.ix1; ix++) {
+				for (int iy = cr.iy0; iy <= cr.iy1; iy++) start_[Bucket(ix, iy, k) + 1]++;
+			}
+		}
+	}
+	for (int b = 0; b < num_buckets; b++) start_[b + 1] += start_[b];
+	entries_.resize(total);
+	std::vector<int> fill(start_.begin(), start_.end() - 1);
+	for (int i = 0; i < (int)obstacles_.size(); i++) {
+		for (int k = 0; k < num_slices_; k++) {
+			const CellRange &cr = ranges[i * num_slices_ + k];
+			for (int ix = cr.ix0; ix <= cr.ix1; ix++) {
+				for (int iy = cr.iy0; iy <= cr.iy1; iy++) entries_[fill[Bucket(ix, iy, k)]++] = i;
+			}
+		}
+	}
+}
+
+float DynamicObstacleMap::Distance(float x, float y, float t) const {
+	float dist = std::numeric_limits<float>::max();
+	if (num_slices_ == 0) return dist;
+	t = std::min(std::max(t, 0.0f), horizon_);
+	int slice = std::min(num_slices_ - 1, (int)floorf(t / slice_dt_ + 0.5f));
+	int b = Bucket((int)floorf(x / cell_size_), (int)floorf(y / cell_size_), slice);
+	// every obstacle within the influence distance is in the bucket, hash collisions
+	// only add obstacles to test, and the nearest one may be farther than the influence
+	dist = influence_;
+	for (int e = start_[b]; e < start_[b + 1]; e++) {
+		const DynamicObstacle &o = obstacles_[entries_[e]];
+		float dx = x - (o.x + o.vx*t);
+		float dy = y - (o.y + o.vy*t);
+		dist = std::min(dist, sqrtf(dx*dx + dy*dy) - o.radius);
+	}
+	return dist;
+}
+
+} // namespace planning
+} // namespace avt_341
@@ -1,5 +1,9 @@
 #include "avt_341/planning/local/pf_planner.h"
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <functional>
 
 namespace avt_341 {
 namespace planning{
@@ -7,36 +11,55 @@ PfPlanner::PfPlanner() {
 	kp_ = 5.0f;
 	eta_ = 100.0f;
 	obs_cutoff_dist_ = 20.0f;
+	goal_x_ = 0.0f;
+	goal_y_ = 0.0f;
+	width_ = 0;
+	height_ = 0;
+	minx_ = 0.0f;
+	miny_ = 0.0f;
+	reso_ = 1.0f;
+	bucket_size_ = 1.0f;
+	bucket_nx_ = 0;
+	bucket_ny_ = 0;
+	map_valid_ = false;
+	wavefront_gi_ = 0;
+	wavefront_gj_ = 0;
+	wavefront_valid_ = false;
+	use_gradient_ = false;
 }
 
-avt_341::msg::Path PfPlanner::Plan(avt_341::msg::OccupancyGrid grid, avt_341::msg::Odometry odom){
+void PfPlanner::SetGrid(const avt_341::msg::OccupancyGrid &grid){
+	width_ = grid.info.width;
+	height_ = grid.info.height;
+	minx_ = grid.info.origin.position.x;
+	miny_ = grid.info.origin.position.y;
+	reso_ = grid.info.resolution;
+	obstacle_cells_.clear();
+	occupied_.assign(grid.data.size(), 0);
+	for (int i=0;i<(int)grid.data.size();i++){
+		if (grid.data[i]>0){
+			obstacle_cells_.push_back(i);
+			occupied_[i] = 1;
+		}
+	}
+	map_valid_ = false;
+	wavefront_valid_ = false;
+}
+
+avt_341::msg::Path PfPlanner::Plan(const avt_341::msg::Odometry &odom){
 	
 	float sx = odom.pose.pose.position.x;
 	float sy = odom.pose.pose.position.y;
 	float gx = goal_x_; 
 	float gy = goal_y_;
 
-	// first populate the obstacle list from the current grid
-	std::vector<float> ox, oy;
-	int ndx = 0;
-	for (int i=0;i<grid.info.width;i++){
-    float x = grid.info.origin.position.x + (i+0.5f)*grid.info.resolution;
-    float dx = sx-x;
-    for (int j=0;j<grid.info.height;j++){
-      float y = grid.info.origin.position.y + (j+0.5f)*grid.info.resolution;
-      float dy = sy-y;
-      if (grid.data[ndx]>0){
-        float d = sqrtf(dx*dx+dy*dy);
-          if (d<obs_cutoff_dist_){
-            ox.push_back(x);
-            oy.push_back(y);
-					} // if closer than cutoff distance
-			} // if cell occupied
-		} // loop over j
-	} // loop over i
+	// the potential map only changes with the grid and the repulsive parameters,
+	// its cells are computed the first time the descent reads them
+	if (!map_valid_) IndexObstacles();
 
 	// run the potential field algorithm
-	PotentialFieldPlanning(grid.info.origin.position.x,  grid.info.origin.position.y, grid.info.resolution, sx, sy, gx, gy, ox, oy);
+	if (use_gradient_) GradientDescentPlanning(sx, sy, gx, gy);
+	else PotentialFieldPlanning(sx, sy, gx, gy);
 
 	// copy the result to a path message
 	avt_341::msg::Path path;
@@ -50,6 +73,88 @@ avt_341::msg::Path PfPlanner::Plan(avt_341::msg::OccupancyGrid grid, avt_341::ms
 	return path;
 }
 
+void PfPlanner::IndexObstacles(){
+	repulsive_map_.assign(width_*height_, 0.0f);
+	map_ready_.assign(width_*height_, 0);
+	bucket_start_.clear();
+	bucket_x_.clear();
+	bucket_y_.clear();
+	map_valid_ = true;
+	if (width_<=0 || height_<=0 || reso_<=0.0f) return;
+
+	// buckets as large as the cutoff distance, so the obstacles that repulse
+	// a point are all in the 3x3 buckets around it
+	bucket_size_ = std::max(obs_cutoff_dist_, reso_);
+	bucket_nx_ = (int)ceil(width_*reso_/bucket_size_);
+	bucket_ny_ = (int)ceil(height_*reso_/bucket_size_);
+	std::vector<int> bucket(obstacle_cells_.size());
+	bucket_start_.assign(bucket_nx_*bucket_ny_+1, 0);
+	for (int n=0;n<(int)obstacle_cells_.size();n++){
+		int i = obstacle_cells_[n]/height_;
+		int j = obstacle_cells_[n]%height_;
+		int bx = std::min(bucket_nx_-1, (int)((i+0.5f)*reso_/bucket_size_));
+		int by = std::min(bucket_ny_-1, (int)((j+0.5f)*reso_/bucket_size_));
+		bucket[n] = bx*bucket_ny_+by;
+		bucket_start_[bucket[n]+1]++;
+	}
+	for (int b=0;b<bucket_nx_*bucket_ny_;b++) bucket_start_[b+1] += bucket_start_[b];
+
+	// cell centers stored as separate x and y arrays, contiguous per bucket
+	bucket_x_.resize(obstacle_cells_.size());
+	bucket_y_.resize(obstacle_cells_.size());
+	std::vector<int> fill(bucket_start_.begin(), bucket_start_.end()-1);
+	for (int n=0;n<(int)obstacle_cells_.size();n++){
+		int e = fill[bucket[n]]++;
+		bucket_x_[e] = minx_ + (obstacle_cells_[n]/height_+0.5f)*reso_;
+		bucket_y_[e] = miny_ + (obstacle_cells_[n]%height_+0.5f)*reso_;
+	}
+}
+
+float PfPlanner::CellPotential(int i, int j){
+	int c = i*height_+j;
+	if (map_ready_[c]) return repulsive_map_[c];
+
+	float x = minx_ + (i+0.5f)*reso_;
+	float y = miny_ + (j+0.5f)*reso_;
+	int bx = std::min(bucket_nx_-1, (int)((i+0.5f)*reso_/bucket_size_));
+	int by = std::min(bucket_ny_-1, (int)((j+0.5f)*reso_/bucket_size_));
+	const float c2 = obs_cutoff_dist_*obs_cutoff_dist_;
+	const float eta = eta_;
+	// independent partial sums, so the additions do not wait on each other
+	float part[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+	float repul = 0.0f;
+	for (int ib=std::max(0, bx-1);ib<=std::min(bucket_nx_-1, bx+1);ib++){
+		// the buckets of a column are contiguous, so the 3 of them are summed as one run
+		int b0 = ib*bucket_ny_+std::max(0, by-1);
+		int b1 = ib*bucket_ny_+std::min(bucket_ny_-1, by+1);
+		const float *ox = bucket_x_.data();
+		const float *oy = bucket_y_.data();
+		const int end = bucket_start_[b1+1];
+		int e = bucket_start_[b0];
+		// cells beyond the cutoff are masked out instead of branched around, the loops
+		// only vectorize when the file is built without trapping math (see CMakeLists.txt)
+		for (;e+8<=end;e+=8){
+			for (int k=0;k<8;k++){
+				float dx = x - ox[e+k];
+				float dy = y - oy[e+k];
+				float d2 = dx*dx + dy*dy;
+				float w = eta/(d2+0.1f);
+				part[k] += (d2<c2 ? 1.0f : 0.0f)*w;
+			}
+		}
+		for (;e<end;e++){
+			float dx = x - ox[e];
+			float dy = y - oy[e];
+			float d2 = dx*dx + dy*dy;
+			float w = eta/(d2+0.1f);
+			repul += (d2<c2 ? 1.0f : 0.0f)*w;
+		}
+	}
+	for (int k=0;k<8;k++) repul += part[k];
+	repulsive_map_[c] = repul;
+	map_ready_[c] = 1;
+	return repul;
+}
 
 void PfPlanner::SetGoal(float gx, float gy){
 	goal_x_ = gx;
@@ -64,17 +169,32 @@ float PfPlanner::CalcAttractivePotential(float x, float y, float gx, float gy){
 	return 0.5f * kp_ * Hypot(x - gx, y - gy);
 }
 
-float PfPlanner::CalcRepulsivePotential(float x, float y, std::vector<float> ox, std::vector<float> oy){
-
-	float repul = 0.0f;
-
-	if (ox.size()!=oy.size())return repul;
+float PfPlanner::CalcRepulsivePotential(float x, float y, float *grad_x, float *grad_y){
+	if (grad_x) *grad_x = 0.0f;
+	if (grad_y) *grad_y = 0.0f;
+	if (repulsive_map_.size()==0) return 0.0f;
 
-	for (int i=0;i<(int)ox.size();i++){
-		float d = Hypot(x - ox[i], y - oy[i]);
-		repul += eta_/(d*d+0.1f);
+	// bilinear interpolation between the cell centers, clamped to the edge of the grid
+	float fx = std::min(std::max((x - minx_)/reso_ - 0.5f, 0.0f), (float)(width_-1));
+	float fy = std::min(std::max((y - miny_)/reso_ - 0.5f, 0.0f), (float)(height_-1));
+	int i0 = std::min((int)fx, width_-2 > 0 ? width_-2 : 0);
+	int j0 = std::min((int)fy, height_-2 > 0 ? height_-2 : 0);
+	int i1 = std::min(i0+1, width_-1);
+	int j1 = std::min(j0+1, height_-1);
+	float tx = fx - i0;
+	float ty = fy - j0;
+	float p00 = CellPotential(i0, j0);
+	float p01 = CellPotential(i0, j1);
+	float p10 = CellPotential(i1, j0);
+	float p11 = CellPotential(i1, j1);
+	// the gradient is zero across the edge of the grid, where the lookup is clamped
+	if (grad_x && x > minx_ + 0.5f*reso_ && x < minx_ + (width_-0.5f)*reso_){
+		*grad_x = ((1.0f-ty)*(p10-p00) + ty*(p11-p01))/reso_;
 	}
-	return repul;
+	if (grad_y && y > miny_ + 0.5f*reso_ && y < miny_ + (height_-0.5f)*reso_){
+		*grad_y = ((1.0f-tx)*(p01-p00) + tx*(p11-p10))/reso_;
+	}
+	return (1.0f-tx)*((1.0f-ty)*p00 + ty*p01) + tx*((1.0f-ty)*p10 + ty*p11);
 }
 
 std::vector<std::vector<float> > PfPlanner::GetMotionModel(float step){
@@ -85,7 +205,7 @@ std::vector<std::vector<float> > PfPlanner::GetMotionModel(float step){
 	motion[0][0] = step;
 	motion[1][1] = step;
 	motion[2][0] = -step;
-	motion[3][1] = step;
+	motion[3][1] = -step;
 	motion[4][0] = -step;
 	motion[4][1] = -step;
 	motion[5][0] = -step;
@@ -97,25 +217,20 @@ std::vector<std::vector<float> > PfPlanner::GetMotionModel(float step){
 	return motion;
 }
 
-void PfPlanner::PotentialFieldPlanning(float minx, float miny, float reso, float sx, float sy, float gx, float gy, std::vector<float> ox, std::vector<float> oy){
+void PfPlanner::PotentialFieldPlanning(float sx, float sy, float gx, float gy){
 
 	rx_.clear();
 	ry_.clear();
 	
 	//# search path
-	//float minx = grid.info.origin.position.x;
-	//float miny = grid.info.origin.position.y;
-	//float reso = grid.info.resolution;
+	float reso = reso_;
 	float d = Hypot(sx - gx, sy - gy);
 	float max_steps = floor(3.0f*d);
-	int ix = (int)floor((sx - minx) / reso);
-	int iy = (int)floor((sy - miny) / reso);
-	int gix = (int)floor((gx - minx) / reso);
-	int giy = (int)floor((gy - miny) / reso);
 	rx_.push_back(sx);
 	ry_.push_back(sy);
 	float xp = sx;
 	float yp = sy;
+	// one cell per step
 	std::vector<std::vector<float > > motion = GetMotionModel(reso);
 	int nsteps = 0;
 	
@@ -126,12 +241,12 @@ void PfPlanner::PotentialFieldPlanning(float minx, float miny, float reso, float
 		float mindy = 0.0f; 
 		
 		for (int i=0;i<(int)motion.size();i++){
-			float dx = reso*motion[i][0];
-			float dy = reso*motion[i][1];
+			float dx = motion[i][0];
+			float dy = motion[i][1];
 			float xx = xp+dx;
 			float yy = yp+dy;
 			float ug = CalcAttractivePotential(xx, yy, gx, gy);
-			float uo = CalcRepulsivePotential(xx, yy, ox, oy);
+			float uo = CalcRepulsivePotential(xx, yy);
 			float p = ug + uo;
 			if (minp > p){
 				minp = p;
@@ -148,5 +263,156 @@ void PfPlanner::PotentialFieldPlanning(float minx, float miny, float reso, float
 	}
 }
 
+void PfPlanner::GradientDescentPlanning(float sx, float sy, float gx, float gy){
+
+	rx_.clear();
+	ry_.clear();
+	rx_.push_back(sx);
+	ry_.push_back(sy);
+	if (repulsive_map_.size()==0) return;
+
+	// the path is limited to 3 times the straight line distance, like the discrete descent
+	float d = Hypot(sx - gx, sy - gy);
+	float max_length = 3.0f*d;
+	int max_iterations = 4*(int)ceil(max_length/reso_) + 1;
+	float h_min = 0.1f*reso_;
+	float h_max = 2.0f*reso_;
+	float h = reso_;
+	// a local minimum is also detected when 10 steps bring the path less than a cell closer to the goal
+	const int progress_window = 10;
+
+	float xp = sx;
+	float yp = sy;
+	float rgx, rgy;
+	float u = CalcAttractivePotential(xp, yp, gx, gy) + CalcRepulsivePotential(xp, yp, &rgx, &rgy);
+	float length = 0.0f;
+	float window_d = d;
+	int window_steps = 0;
+	for (int it=0;it<max_iterations && d>=reso_ && length<max_length;it++){
+		float dx = rgx + 0.5f*kp_*(xp - gx)/d;
+		float dy = rgy + 0.5f*kp_*(yp - gy)/d;
+		float gn = Hypot(dx, dy);
+		bool stuck = gn < 1.0E-6f;
+		if (!stuck){
+			float xn = xp - h*dx/gn;
+			float yn = yp - h*dy/gn;
+			float ngx, ngy;
+			float un = CalcAttractivePotential(xn, yn, gx, gy) + CalcRepulsivePotential(xn, yn, &ngx, &ngy);
+			if (un < u){
+				// accept and try a longer step next
+				xp = xn;
+				yp = yn;
+				u = un;
+				rgx = ngx;
+				rgy = ngy;
+				length += h;
+				d = Hypot(gx - xp, gy - yp);
+				rx_.push_back(xp);
+				ry_.push_back(yp);
+				h = std::min(1.5f*h, h_max);
+				window_steps++;
+			}
+			else {
+				h = 0.5f*h;
+				stuck = h < h_min;
+			}
+		}
+		if (!stuck && window_steps>=progress_window){
+			stuck = window_d - d < reso_;
+			window_d = d;
+			window_steps = 0;
+		}
+		if (stuck){
+			// leave the local minimum along the wavefront until the potential is below the minimum's,
+			// so the descent that resumes from there cannot fall back into it
+			int first = (int)rx_.size();
+			int max_cells = (int)ceil((max_length - length)/reso_);
+			if (FollowWavefront(xp, yp, gx, gy, u, max_cells)==0) break;
+			for (int i=first;i<(int)rx_.size();i++) length += Hypot(rx_[i] - rx_[i-1], ry_[i] - ry_[i-1]);
+			d = Hypot(gx - xp, gy - yp);
+			u = CalcAttractivePotential(xp, yp, gx, gy) + CalcRepulsivePotential(xp, yp, &rgx, &rgy);
+			h = reso_;
+			window_d = d;
+			window_steps = 0;
+		}
+	}
+}
+
+void PfPlanner::ComputeWavefront(float gx, float gy){
+	int gi = (int)floor((gx - minx_)/reso_);
+	int gj = (int)floor((gy - miny_)/reso_);
+	if (wavefront_valid_ && gi==wavefront_gi_ && gj==wavefront_gj_) return;
+	wavefront_gi_ = gi;
+	wavefront_gj_ = gj;
+	wavefront_valid_ = true;
+	wavefront_.assign(width_*height_, std::numeric_limits<float>::max());
+
+	// Dijkstra over the free cells with 8 neighbours, from the goal cell,
+	// or from the free edge cells at their distance to the goal if the goal is off the grid
+	typedef std::pair<float, int> Node;
+	std::priority_queue<Node, std::vector<Node>, std::greater<Node> > open;
+	if (gi>=0 && gi<width_ && gj>=0 && gj<height_){
+		wavefront_[gi*height_+gj] = 0.0f;
+		open.push(Node(0.0f, gi*height_+gj));
+	}
+	else {
+		for (int i=0;i<width_;i++){
+			for (int j=0;j<height_;j++){
+				if (i>0 && i<width_-1 && j>0 && j<height_-1) j = height_-1;
+				int c = i*height_+j;
+				if (occupied_[c]) continue;
+				wavefront_[c] = Hypot(i + 0.5f - (gx - minx_)/reso_, j + 0.5f - (gy - miny_)/reso_);
+				open.push(Node(wavefront_[c], c));
+			}
+		}
+	}
+	while (!open.empty()){
+		Node node = open.top();
+		open.pop();
+		if (node.first > wavefront_[node.second]) continue;
+		int i = node.second/height_;
+		int j = node.second%height_;
+		for (int ni=std::max(0, i-1);ni<=std::min(width_-1, i+1);ni++){
+			for (int nj=std::max(0, j-1);nj<=std::min(height_-1, j+1);nj++){
+				int c = ni*height_+nj;
+				if (c==node.second || occupied_[c]) continue;
+				float cost = node.first + ((ni!=i && nj!=j) ? 1.41421356f : 1.0f);
+				if (cost < wavefront_[c]){
+					wavefront_[c] = cost;
+					open.push(Node(cost, c));
+				}
+			}
+		}
+	}
+}
+
+int PfPlanner::FollowWavefront(float &xp, float &yp, float gx, float gy, float max_potential, int max_cells){
+	int i = (int)floor((xp - minx_)/reso_);
+	int j = (int)floor((yp - miny_)/reso_);
+	if (i<0 || i>=width_ || j<0 || j>=height_) return 0;
+	ComputeWavefront(gx, gy);
+
+	// steepest descent of the wavefront, one cell at a time
+	int ncells = 0;
+	while (ncells<max_cells){
+		int best = i*height_+j;
+		for (int ni=std::max(0, i-1);ni<=std::min(width_-1, i+1);ni++){
+			for (int nj=std::max(0, j-1);nj<=std::min(height_-1, j+1);nj++){
+				if (wavefront_[ni*height_+nj] < wavefront_[best]) best = ni*height_+nj;
+			}
+		}
+		if (best==i*height_+j) break;
+		i = best/height_;
+		j = best%height_;
+		xp = minx_ + (i+0.5f)*reso_;
+		yp = miny_ + (j+0.5f)*reso_;
+		rx_.push_back(xp);
+		ry_.push_back(yp);
+		ncells++;
+		if (CalcAttractivePotential(xp, yp, gx, gy) + CalcRepulsivePotential(xp, yp) < max_potential) break;
+	}
+	return ncells;
+}
+
 } // namespace planning
 } // namespace avt_341
\ No newline at end of file
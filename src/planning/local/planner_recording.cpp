@@ -0,0 +1,84 @@
+#include "avt_341/planning/local/planner_recording.h"
+#include <fstream>
+#include <limits>
+#include <cstdlib>
+
+namespace avt_341 {
+namespace planning{
+
+static void WriteGrid(std::ostream &out, const avt_341::msg::OccupancyGrid &grid, bool is_new) {
+	// an unchanged grid is only referred to
+	if (!is_new) {
+		out << "grid same\n";
+		return;
+	}
+	out << "grid " << grid.info.width << " " << grid.info.height << " " << grid.info.resolution << " " <<
+		grid.info.origin.position.x << " " << grid.info.origin.position.y << " " << grid.data.size() << "\n";
+	for (size_t i = 0; i < grid.data.size(); i++) {
+		out << (int)grid.data[i] << (i + 1 < grid.data.size() ? " " : "");
+	}
+	out << "\n";
+}
+
+static bool ReadGrid(std::istream &in, avt_341::msg::OccupancyGrid &grid, bool &is_new) {
+	std::string tag;
+	size_t n;
+	if (!(in >> tag) || tag != "grid" || !(in >> tag)) return false;
+	is_new = tag != "same";
+	if (!is_new) return true;
+	char *end;
+	grid.info.width = strtoul(tag.c_str(), &end, 10);
+	if (*end != '\0') return false;
+	if (!(in >> grid.info.height >> grid.info.resolution >>
+		grid.info.origin.position.x >> grid.info.origin.position.y >> n)) return false;
+	grid.data.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		int v;
+		if (!(in >> v)) return false;
+		grid.data[i] = (int8_t)v;
+	}
+	return true;
+}
+
+bool WritePlannerInput(std::ostream &out, const PlannerInput &input) {
+	const avt_341::msg::Odometry &odom = input.odom;
+	out.precision(std::numeric_limits<double>::max_digits10);
+	out << "cycle\n";
+	out << "odom " << odom.pose.pose.position.x << " " << odom.pose.pose.position.y << " " << odom.pose.pose.position.z << " " <<
+		odom.pose.pose.orientation.x << " " << odom.pose.pose.orientation.y << " " << odom.pose.pose.orientation.z << " " <<
+		odom.pose.pose.orientation.w << " " << odom.twist.twist.linear.x << " " << odom.twist.twist.linear.y << "\n";
+	out << "path " << input.path.poses.size() << "\n";
+	for (size_t i = 0; i < input.path.poses.size(); i++) {
+		out << input.path.poses[i].pose.position.x << " " << input.path.poses[i].pose.position.y << "\n";
+	}
+	WriteGrid(out, input.grid, input.new_grid);
+	WriteGrid(out, input.segmentation_grid, input.new_segmentation_grid);
+	return (bool)out;
+}
+
+bool ReadPlannerInputs(const std::string &fname, std::vector<PlannerInput> &inputs) {
+	std::ifstream in(fname.c_str());
+	if (!in.is_open()) return false;
+	std::string tag;
+	while (in >> tag) {
+		if (tag != "cycle") return false;
+		PlannerInput input;
+		avt_341::msg::Odometry &odom = input.odom;
+		if (!(in >> tag) || tag != "odom") return false;
+		if (!(in >> odom.pose.pose.position.x >> odom.pose.pose.position.y >> odom.pose.pose.position.z >>
+			odom.pose.pose.orientation.x >> odom.pose.pose.orientation.y >> odom.pose.pose.orientation.z >>
+			odom.pose.pose.orientation.w >> odom.twist.twist.linear.x >> odom.twist.twist.linear.y)) return false;
+		size_t np;
+		if (!(in >> tag) || tag != "path" || !(in >> np)) return false;
+		input.path.poses.resize(np);
+		for (size_t i = 0; i < np; i++) {
+			if (!(in >> input.path.poses[i].pose.position.x >> input.path.poses[i].pose.position.y)) return false;
+		}
+		if (!ReadGrid(in, input.grid, input.new_grid) || !ReadGrid(in, input.segmentation_grid, input.new_segmentation_grid)) return false;
+		inputs.push_back(input);
+	}
+	return true;
+}
+
+} // namespace planning
+} // namespace avt_341
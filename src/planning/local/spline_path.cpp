@@ -1,10 +1,13 @@
 #include "avt_341/planning/local/spline_path.h"
+#include <algorithm>
 
 namespace avt_341 {
 namespace planning{
 
 Path::Path() {
 	max_lookahead_ = std::numeric_limits<float>::max();
+	last_segment_ = -1;
+	hash_built_ = false;
 }
 
 Path::Path(std::vector<utils::vec2> points) {
@@ -29,6 +32,8 @@ void Path::Init(std::vector<utils::vec2> points, utils::vec2 position, float la)
 void Path::Init(std::vector<utils::vec2> points) {
 	points_ = points;
 	CalcAnglesAndCurvature();
+	last_segment_ = -1;
+	hash_built_ = false;
 }
 
 
@@ -62,18 +67,19 @@ void Path::CalcAnglesAndCurvature() {
 		curvature_[0] = curvature_[1];
 		curvature_[points_.size() - 1] = curvature_[points_.size() - 2];
 	}
-	for (int i = 0; i < points_.size()-1; i++) {
+	for (int i = 0; i < (int)points_.size()-1; i++) {
 		utils::vec2 v1 = points_[i + 1] - points_[i];
 		discrete_lengths_[i] = utils::length(v1);
 	}
 	//angle and arc length
-	for (int i = 1; i < points_.size()-1; i++) {
+	for (int i = 1; i < points_.size(); i++) {
+		arc_length_[i] = arc_length_[i-1] + discrete_lengths_[i-1];
+	}
+	for (int i = 1; i < (int)points_.size()-1; i++) {
 		utils::vec2 v0 = points_[i] - points_[i - 1];
 		utils::vec2 v1 = points_[i + 1] - points_[i];
-		float sl = utils::length(v0);
-		v0 = v0 / sl; //utils::length(v0);
-		v1 = v1 / utils::length(v1);
-		arc_length_[i] = arc_length_[i-1]+sl;
+		v0 = v0 / discrete_lengths_[i - 1];
+		v1 = v1 / discrete_lengths_[i];
 		float theta0 = (float)atan2(v0.y, v0.x);
 		float theta1 = (float)atan2(v1.y, v1.x);
 		theta_[i] = 0.5f*(theta0 + theta1);
@@ -83,12 +89,28 @@ void Path::CalcAnglesAndCurvature() {
 		utils::vec2 v_first = points_[1] - points_[0];
 		v_first = v_first / utils::length(v_first);
 		utils::vec2 v_last = points_[points_.size() - 1] - points_[points_.size() - 2];
-		float sl = utils::length(v_last);
-		v_last = v_last / sl; //utils::length(v_last);
-		arc_length_[points_.size()-1] = arc_length_[points_.size()-2] + sl;
+		v_last = v_last / utils::length(v_last);
 		theta_[0] = (float)atan2(v_first.y, v_first.x);
 		theta_[points_.size() - 1] = (float)atan2(v_last.y, v_last.x);
 	}
+	// per segment tangents and slopes for linear interpolation of curvature and angle
+	int nseg = std::max(0, (int)points_.size() - 1);
+	tangent_.resize(nseg);
+	curvature_slope_.resize(nseg);
+	theta_slope_.resize(nseg);
+	for (int i = 0; i < nseg; i++) {
+		float len = discrete_lengths_[i];
+		if (len > 0.0f) {
+			tangent_[i] = (points_[i + 1] - points_[i]) / len;
+			curvature_slope_[i] = (curvature_[i + 1] - curvature_[i]) / len;
+			theta_slope_[i] = (theta_[i + 1] - theta_[i]) / len;
+		}
+		else {
+			tangent_[i] = utils::vec2(0.0f, 0.0f);
+			curvature_slope_[i] = 0.0f;
+			theta_slope_[i] = 0.0f;
+		}
+	}
 }
 
 float Path::GetTheta(float s){
@@ -96,6 +118,11 @@ float Path::GetTheta(float s){
 	return theta_[seg.id];
 }
 
+float Path::GetTheta(float s, int &cursor){
+	SegmentInfo seg = FindSegment(s, cursor);
+	return theta_[seg.id];
+}
+
 PointSegDist Path::PointToSegmentDistance(utils::vec2 P, utils::vec2 Q, utils::vec2 X) {
 	// https ://diego.assencio.com/?index=ec3d5dfdfc0b6a0d147a656f0af332bd
 	utils::vec2 XP = X - P;  
@@ -123,56 +150,39 @@ PointSegDist Path::PointToSegmentDistance(utils::vec2 P, utils::vec2 Q, utils::v
 	return pseg;
 }
 
-SegmentInfo Path::FindSegment(float s) {
+int Path::SegmentIndex(float s) const {
+	// first waypoint beyond s, clamped so s before the start or past the end uses the end segments
+	int n = (int)arc_length_.size();
+	int i = (int)(std::upper_bound(arc_length_.begin() + 1, arc_length_.end(), s) - arc_length_.begin());
+	return std::min(i, n - 1) - 1;
+}
+
+SegmentInfo Path::MakeSegmentInfo(int id, float s) {
 	SegmentInfo segment;
-	/*
-	float cum_dist = 0.0;
-	int wp = 0;
-	segment.id = 0; 
-	while (cum_dist < s && wp < points_.size() - 1) {
-		float d = utils::length(points_[wp] - points_[wp + 1]);
-		if (d + cum_dist >= s) {
-			segment.id = wp;
-			float t = s - cum_dist;
-			utils::vec2 v = points_[wp + 1] - points_[wp];
-			v = v / utils::length(v);
-			segment.point = points_[wp] + v * t; 
-			break;
-		}
-		cum_dist = cum_dist + d;
-		wp = wp + 1;
+	segment.id = id;
+	segment.offset = s - arc_length_[id];
+	segment.point = points_[id] + tangent_[id] * segment.offset;
+	return segment;
+}
+
+SegmentInfo Path::FindSegment(float s) {
+	return MakeSegmentInfo(SegmentIndex(s), s);
+}
+
+SegmentInfo Path::FindSegment(float s, int &cursor) {
+	int nseg = (int)arc_length_.size() - 1;
+	if (cursor < 0 || cursor >= nseg || (cursor > 0 && s < arc_length_[cursor])) {
+		cursor = SegmentIndex(s);
 	}
-	*/	
-	bool found = false;
-	for (int i=1;i<arc_length_.size();i++){
-		if (arc_length_[i]>s){
-			segment.id = i-1;
-			float t = s - arc_length_[i-1];
-			utils::vec2 v = points_[i] - points_[i-1];
-			v = v / utils::length(v);
-			segment.point = points_[i] + v * t; 
-			found = true;
-			break;
-		}
-	}	
-	if (!found){
-		int i = arc_length_.size()-1;
-		segment.id = i-1;
-		float t = s - arc_length_[i-1];
-		utils::vec2 v = points_[i] - points_[i-1];
-		v = v / utils::length(v);
-		segment.point = points_[i] + v * t; 
+	else {
+		// walk forward, s usually moves by less than a segment between calls
+		while (cursor < nseg - 1 && arc_length_[cursor + 1] <= s) cursor++;
 	}
-
-	return segment;
+	return MakeSegmentInfo(cursor, s);
 }
 
 float Path::GetTotalLength() {
-	float cum_dist = 0.0;
-	for (int i = 0; i < points_.size() - 1; i++) {
-		cum_dist += utils::length(points_[i] - points_[i + 1]);
-	}
-	return cum_dist;
+	return arc_length_.empty() ? 0.0f : arc_length_[arc_length_.size() - 1];
 }
 
 void Path::FixBeginning(float x, float y){
@@ -191,81 +201,165 @@ void Path::FixBeginning(float x, float y){
 }
 
 
+void Path::BuildSegmentHash() {
+	// uniform grid over the bounding box of the path, each cell lists the segments whose bounding box overlaps it
+	int nseg = (int)points_.size() - 1;
+	hash_start_.clear();
+	hash_segments_.clear();
+	hash_built_ = true;
+	if (nseg < 1) return;
+	utils::vec2 lo = points_[0];
+	utils::vec2 hi = points_[0];
+	for (int i = 1; i < points_.size(); i++) {
+		lo.x = std::min(lo.x, points_[i].x);
+		lo.y = std::min(lo.y, points_[i].y);
+		hi.x = std::max(hi.x, points_[i].x);
+		hi.y = std::max(hi.y, points_[i].y);
+	}
+	// cells about twice the mean segment length, limited to a few cells per segment
+	float cell = std::max(2.0f * arc_length_[nseg] / nseg, 1.0f);
+	while ((int)((hi.x - lo.x) / cell + 1) * (int)((hi.y - lo.y) / cell + 1) > 4 * nseg + 16) cell *= 2.0f;
+	hash_cell_size_ = cell;
+	hash_origin_ = lo;
+	hash_nx_ = (int)((hi.x - lo.x) / cell) + 1;
+	hash_ny_ = (int)((hi.y - lo.y) / cell) + 1;
+
+	// two passes, count then fill, so the cell lists are stored contiguously
+	hash_start_.assign(hash_nx_ * hash_ny_ + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<int> fill;
+		if (pass == 1) {
+			for (int c = 0; c < hash_nx_ * hash_ny_; c++) hash_start_[c + 1] += hash_start_[c];
+			hash_segments_.resize(hash_start_[hash_nx_ * hash_ny_]);
+			fill.assign(hash_start_.begin(), hash_start_.end() - 1);
+		}
+		for (int i = 0; i < nseg; i++) {
+			int cx0 = (int)((std::min(points_[i].x, points_[i + 1].x) - lo.x) / cell);
+			int cx1 = (int)((std::max(points_[i].x, points_[i + 1].x) - lo.x) / cell);
+			int cy0 = (int)((std::min(points_[i].y, points_[i + 1].y) - lo.y) / cell);
+			int cy1 = (int)((std::max(points_[i].y, points_[i + 1].y) - lo.y) / cell);
+			for (int cx = cx0; cx <= cx1; cx++) {
+				for (int cy = cy0; cy <= cy1; cy++) {
+					int c = cx * hash_ny_ + cy;
+					if (pass == 0) hash_start_[c + 1]++;
+					else hash_segments_[fill[c]++] = i;
+				}
+			}
+		}
+	}
+}
+
+void Path::TestSegment(int i, utils::vec2 tp, SRhoSearch &best) {
+	PointSegDist d = PointToSegmentDistance(points_[i], points_[i + 1], tp);
+	// ties go to the lower index, as with a scan from the start of the path
+	if (d.dist < best.dist || (d.dist == best.dist && i < best.index)) {
+		best.dist = d.dist;
+		best.point = d.point;
+		best.index = i;
+	}
+}
+
+bool Path::FindClosestSegmentHashed(utils::vec2 tp, SRhoSearch &best) {
+	if (!hash_built_) BuildSegmentHash();
+	if (hash_start_.empty()) return false;
+	float fx = (tp.x - hash_origin_.x) / hash_cell_size_;
+	float fy = (tp.y - hash_origin_.y) / hash_cell_size_;
+	if (fx < 0.0f || fy < 0.0f || fx >= hash_nx_ || fy >= hash_ny_) return false;
+	int qx = (int)fx;
+	int qy = (int)fy;
+	int max_ring = std::max(hash_nx_, hash_ny_);
+	for (int r = 0; r <= max_ring; r++) {
+		for (int cx = qx - r; cx <= qx + r; cx++) {
+			if (cx < 0 || cx >= hash_nx_) continue;
+			bool edge_column = (cx == qx - r || cx == qx + r);
+			for (int cy = qy - r; cy <= qy + r; cy += (edge_column || r == 0) ? 1 : 2 * r) {
+				if (cy < 0 || cy >= hash_ny_) continue;
+				int c = cx * hash_ny_ + cy;
+				for (int k = hash_start_[c]; k < hash_start_[c + 1]; k++) {
+					TestSegment(hash_segments_[k], tp, best);
+				}
+			}
+		}
+		// every cell of the next ring is at least r cells away
+		if (best.index >= 0 && best.dist <= r * hash_cell_size_) break;
+	}
+	return best.index >= 0;
+}
+
 utils::vec2 Path::ToSRho(float x, float y) {
-	// First find the closest segment
-	int closest_index = 0;
-	float closest = std::numeric_limits<float>::max();
+	utils::vec2 sr(0.0f, 0.0f);
+	int nseg = (int)points_.size() - 1;
+	if (nseg < 1) return sr;
 	utils::vec2 tp(x, y);
-	utils::vec2 closest_point;
-	float dist_sign = 1.0f;
-	for (int i = 0; i < points_.size() - 1; i++) {
-		utils::vec2 seg = points_[i + 1] - points_[i];
-		PointSegDist d = PointToSegmentDistance(points_[i], points_[i + 1], tp);
-		if (d.dist < closest) {
-			utils::vec2 v = tp - points_[i];
-			float sign =  v.y*seg.x - v.x*seg.y;
-			float smag = fabs(sign);
-			if (smag>0.0f) dist_sign = sign / fabs(sign);
-			closest = d.dist;
-			closest_point = d.point;
-			closest_index = i;
-		}
+	SRhoSearch best;
+	best.index = -1;
+	best.dist = std::numeric_limits<float>::max();
+
+	// track from the previous solution, accepting it only if the closest
+	// segment is inside the window and not farther than a hash cell
+	bool tracked = false;
+	if (last_segment_ >= 0 && last_segment_ < nseg) {
+		const int window = 8;
+		int i0 = std::max(0, last_segment_ - window);
+		int i1 = std::min(nseg - 1, last_segment_ + window);
+		for (int i = i0; i <= i1; i++) TestSegment(i, tp, best);
+		if (!hash_built_) BuildSegmentHash();
+		bool interior = (best.index > i0 || i0 == 0) && (best.index < i1 || i1 == nseg - 1);
+		tracked = interior && best.dist <= hash_cell_size_;
 	}
-	
-	float rho = dist_sign*closest;
-	float s = 0.0f;
-	for (int i = 0; i < closest_index; i++) {
-		s += utils::length(points_[i] - points_[i + 1]);
+	if (!tracked) {
+		best.index = -1;
+		best.dist = std::numeric_limits<float>::max();
+		if (!FindClosestSegmentHashed(tp, best)) {
+			for (int i = 0; i < nseg; i++) TestSegment(i, tp, best);
+		}
 	}
+	last_segment_ = best.index;
 
-	s += utils::length(closest_point - points_[closest_index]);
+	int i = best.index;
+	utils::vec2 seg = points_[i + 1] - points_[i];
+	utils::vec2 v = tp - points_[i];
+	float sign = v.y*seg.x - v.x*seg.y;
+	float dist_sign = 1.0f;
+	if (fabs(sign) > 0.0f) dist_sign = sign / fabs(sign);
 
-	utils::vec2 sr;
-	sr.x = s;
-	sr.y = rho;
+	sr.x = arc_length_[i] + utils::length(best.point - points_[i]);
+	sr.y = dist_sign*best.dist;
 	return sr;
 }
 
 utils::vec2 Path::ToCartesian(float s, float rho) {
-	float cumulative_distance = 0.0f;
-	int segment = 0;
-	while (cumulative_distance<s && segment<(points_.size()-1)){
-		float arc_length = discrete_lengths_[segment];
-		if (cumulative_distance+arc_length>s){
-			break;
-		}
-		else{
-			cumulative_distance+=arc_length;
-			segment++;
-		}
-	}
-	utils::vec2 v = points_[segment + 1] - points_[segment];
-	v = v / utils::length(v);
-	utils::vec2 n(-v.y, v.x);
-	utils::vec2 p = points_[segment] + v*(s-cumulative_distance)+n*rho;
+	PathFrame frame = GetFrameAt(s);
+	utils::vec2 n(-frame.tangent.y, frame.tangent.x);
+	utils::vec2 p = frame.point + n*rho;
 	return p;
 }
 
+PathFrame Path::GetFrameAt(float s) {
+	int cursor = -1;
+	return GetFrameAt(s, cursor);
+}
+
+PathFrame Path::GetFrameAt(float s, int &cursor) {
+	SegmentInfo seg = FindSegment(s, cursor);
+	PathFrame frame;
+	frame.tangent = tangent_[seg.id];
+	frame.point = seg.point;
+	return frame;
+}
+
 CurveInfo Path::GetCurvatureAndAngle(float s) {
-	SegmentInfo seg = FindSegment(s);
-	float d0 = utils::length(seg.point - points_[seg.id]);
-	float d1 = utils::length(seg.point - points_[seg.id + 1]);
+	int cursor = -1;
+	return GetCurvatureAndAngle(s, cursor);
+}
+
+CurveInfo Path::GetCurvatureAndAngle(float s, int &cursor) {
+	SegmentInfo seg = FindSegment(s, cursor);
+	// linear interpolation between the waypoints of the segment, clamped to the segment
+	float t = std::min(std::max(seg.offset, 0.0f), discrete_lengths_[seg.id]);
 	CurveInfo ca;
-	if (d0 == 0.0f) {
-		ca.curvature = curvature_[seg.id];
-		ca.theta = theta_[seg.id];
-	}
-	else if (d1 == 0.0f) {
-		ca.curvature = curvature_[seg.id + 1];
-		ca.theta = theta_[seg.id + 1];
-	}
-	else {
-		float w0 = 1.0f / d0;
-		float w1 = 1.0f / d1;
-		float w = w0 + w1;
-		ca.curvature = (w0*curvature_[seg.id] + w1 * curvature_[seg.id + 1]) / w;
-		ca.theta = (w0*theta_[seg.id] + w1 * theta_[seg.id + 1]) / w;
-	}
+	ca.curvature = curvature_[seg.id] + curvature_slope_[seg.id] * t;
+	ca.theta = theta_[seg.id] + theta_slope_[seg.id] * t;
 	return ca;
 }
 
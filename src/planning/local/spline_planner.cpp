@@ -1,5 +1,7 @@
 #include "avt_341/planning/local/spline_planner.h"
 #include <algorithm>
+#include <limits>
+#include <cstdlib>
 
 namespace avt_341 {
 namespace planning{
@@ -10,9 +12,6 @@ Planner::Planner() {
 	w_d_ = 0.2f; // dynamic safety
 	w_r_ = 0.4f; // path deviation
 	w_t_ = 0.0f; // terrain segmentation
-	alpha_max_ = 5000.0f;
-	k_safe_ = 0.8f;
-	v_curve_ = 50.0f;
 	a_ = 0.01f; // 0.5f;
 	b_ = 2.0f;
 	averaging_window_size_ = 2;
@@ -24,7 +23,53 @@ Planner::Planner() {
 	first_iter_ = true;
 	s_start_ = 0.0f;
 	s_no_coll_before_ = 0.0f;
+	collision_radius_ = 0.0f;
+	clearance_cost_dist_ = 0.0f;
+	grid_generation_ = 0;
+	segmentation_generation_ = 0;
+	path_generation_ = 0;
+	clearance_valid_ = false;
+	clearance_generation_ = 0;
 	use_blend_ = true;
+	prune_candidates_ = true;
+	check_first_ = 0;
+	check_count_ = 0;
+	adaptive_coarse_paths_ = 0;
+	adaptive_budget_ = 40;
+	lattice_stride_ = 1;
+	gen_rho_start_ = 0.0f;
+	gen_theta_start_ = 0.0f;
+	num_horizons_ = 1;
+	timing_ = nullptr;
+	dynamic_radius_ = 1.5f;
+	dynamic_cost_dist_ = 2.0f;
+	dynamic_horizon_ = 5.0f;
+	dynamic_stride_ = 4;
+	warm_pose_delta_ = 0.0f;
+	warm_heading_delta_ = 0.0f;
+	warm_refresh_cycles_ = 10;
+	warm_valid_ = false;
+	warm_cycles_ = 0;
+	template_ = nullptr;
+	template_rho_quantum_ = 0.0f;
+	template_theta_quantum_ = 0.0f;
+}
+
+void Planner::SetNumThreads(int nt) {
+	if (nt <= 1) pool_.reset();
+	else if (!pool_ || pool_->GetNumThreads() != nt) pool_ = std::make_shared<ThreadPool>(nt);
+}
+
+void Planner::SetTemplateCache(int size, float rho_quantum, float theta_quantum) {
+	template_cache_.SetCapacity(size);
+	template_rho_quantum_ = rho_quantum;
+	template_theta_quantum_ = theta_quantum;
+	template_ = nullptr;
+}
+
+void Planner::ParallelFor(int first, int last, const std::function<void(int, int)> &func) {
+	if (pool_) pool_->ParallelFor(first, last, func);
+	else func(first, last);
 }
 
 std::vector<float> Planner::CalcCoeffs(float rho_start, float theta_start, float s_end, float rho_end) {
@@ -46,23 +91,133 @@ void Planner::GeneratePaths(int npaths, float s_start, float rho_start, float th
 	if (s_end==0) return;
 	float lane_width = s_end*tan(max_steer_angle);
 	candidates_.clear();
+	fan_.Clear();
+	lattice_index_.clear();
+	lattice_rho_.clear();
+	lattice_s_end_.clear();
 	rho_max_ = lane_width;
+	s_max_ = s_end;
+	s_start_ = s_start;
+	CandidateTemplateKey key;
+	if (template_cache_.Enabled()) {
+		// cycles starting from the same quantized conditions have the same candidates
+		key.rho_start = template_rho_quantum_ > 0.0f ? (int)lroundf(rho_start / template_rho_quantum_) : 0;
+		key.theta_start = template_theta_quantum_ > 0.0f ? (int)lroundf(theta_start / template_theta_quantum_) : 0;
+		if (template_rho_quantum_ > 0.0f) rho_start = key.rho_start * template_rho_quantum_;
+		if (template_theta_quantum_ > 0.0f) theta_start = key.theta_start * template_theta_quantum_;
+	}
+	gen_rho_start_ = rho_start;
+	gen_theta_start_ = theta_start;
 	float drho = 2.0f*lane_width / (npaths);
 	float rho = 0.5f*drho - lane_width;
 	averaging_window_size_ = (int)floor(vehicle_width / drho);
+	// end offsets of the full fan
 	while (rho <= (lane_width+1.0E-5f)) {
-		std::vector<float> coeffs = CalcCoeffs(rho_start, theta_start, s_end, rho);
-		Candidate cand(coeffs);
-		cand.SetMaxLength(s_end);
-		cand.SetS0(s_start);
-		candidates_.push_back(cand);
+		lattice_rho_.push_back(rho);
 		rho += drho;
 	}
-	s_max_ = s_end;
-	s_start_ = s_start;
+	int n = (int)lattice_rho_.size();
+	// horizons from half to the full look ahead, the last one is the full look ahead
+	for (int h = 0; h < num_horizons_; h++) {
+		float frac = num_horizons_ > 1 ? 0.5f + 0.5f*h / (num_horizons_ - 1) : 1.0f;
+		lattice_s_end_.push_back(h == num_horizons_ - 1 ? s_end : frac*s_end);
+	}
+	lattice_candidate_.assign(num_horizons_*n, -1);
+
+	// the template has to be known before the candidates are added, they are copied from it
+	template_ = nullptr;
+	if (template_cache_.Enabled() && template_rho_quantum_ > 0.0f && template_theta_quantum_ > 0.0f) {
+		key.s_end = s_end;
+		key.lane_width = lane_width;
+		key.num_offsets = n;
+		key.num_horizons = num_horizons_;
+		key.ds = ds_;
+		key.s_check = s_no_coll_before_;
+		template_ = template_cache_.Find(key);
+		if (!template_) {
+			CandidateTemplate &t = template_cache_.Insert(key);
+			BuildTemplate(t);
+			template_ = &t;
+		}
+	}
+
+	// in adaptive mode start from a coarse subset of each horizon that includes both outermost offsets
+	lattice_stride_ = 1;
+	if (adaptive_coarse_paths_ > 1) {
+		while ((n - 1) / lattice_stride_ + 1 > adaptive_coarse_paths_) lattice_stride_ *= 2;
+	}
+	for (int h = 0; h < num_horizons_; h++) {
+		for (int j = 0; j < n; j += lattice_stride_) AddCandidate(h*n + j);
+		if (n > 0 && lattice_candidate_[h*n + n - 1] < 0) AddCandidate(h*n + n - 1);
+	}
+}
+
+void Planner::BuildTemplate(CandidateTemplate &t) {
+	// tables of every point of the full lattice, so adaptive sampling can use them too
+	int np = (int)lattice_candidate_.size();
+	int n = (int)lattice_rho_.size();
+	template_fan_.Clear();
+	t.candidates.resize(np);
+	t.rho_end.resize(np);
+	t.max_abs_rho.resize(np);
+	for (int p = 0; p < np; p++) {
+		float curve_end = lattice_s_end_[p / n];
+		std::vector<float> coeffs = CalcCoeffs(gen_rho_start_, gen_theta_start_, curve_end, lattice_rho_[p % n]);
+		t.candidates[p] = Candidate(coeffs);
+		t.candidates[p].SetMaxLength(s_max_);
+		t.candidates[p].SetCurveEnd(curve_end);
+		t.rho_end[p] = t.candidates[p].At(s_max_);
+		template_fan_.Add(coeffs, curve_end);
+		t.max_abs_rho[p] = template_fan_.MaxAbsRho(p, s_no_coll_before_, s_max_);
+	}
+	// same samples as TabulatePathSamples
+	t.num_points = np;
+	t.num_samples = 0;
+	t.rho.clear();
+	t.drho.clear();
+	t.d2rho.clear();
+	float s = 0.0f;
+	while (s < s_max_) {
+		t.rho.resize(t.rho.size() + np);
+		t.drho.resize(t.drho.size() + np);
+		t.d2rho.resize(t.d2rho.size() + np);
+		int offset = t.num_samples * np;
+		template_fan_.Evaluate(s, t.rho.data() + offset, t.drho.data() + offset, t.d2rho.data() + offset);
+		t.num_samples++;
+		s += ds_;
+	}
+}
+
+float Planner::SampleRho(int i, int k) const {
+	if (template_) return template_->rho[k * template_->num_points + lattice_index_[i]];
+	return fan_.Rho(i, samples_[k].s);
 }
 
-CurveInfo Planner::InfoOfCurve(Candidate candidate, float s, CurveInfo base_ca) {
+float Planner::SampleSlope(int i, int k) const {
+	if (template_) return template_->drho[k * template_->num_points + lattice_index_[i]];
+	return fan_.Slope(i, samples_[k].s);
+}
+
+void Planner::AddCandidate(int index) {
+	lattice_candidate_[index] = (int)candidates_.size();
+	lattice_index_.push_back(index);
+	if (template_) {
+		candidates_.push_back(template_->candidates[index]);
+		candidates_.back().SetS0(s_start_);
+		return;
+	}
+	int n = (int)lattice_rho_.size();
+	float curve_end = lattice_s_end_[index / n];
+	std::vector<float> coeffs = CalcCoeffs(gen_rho_start_, gen_theta_start_, curve_end, lattice_rho_[index % n]);
+	Candidate cand(coeffs);
+	cand.SetMaxLength(s_max_);
+	cand.SetCurveEnd(curve_end);
+	cand.SetS0(s_start_);
+	candidates_.push_back(cand);
+	fan_.Add(coeffs, curve_end);
+}
+
+CurveInfo Planner::InfoOfCurve(const Candidate &candidate, float s, const CurveInfo &base_ca) {
 	CurveInfo ca;
 	float k0 = base_ca.curvature;
 	float rho = candidate.At(s);
@@ -78,131 +233,615 @@ CurveInfo Planner::InfoOfCurve(Candidate candidate, float s, CurveInfo base_ca)
 	return ca;
 }
 
-void Planner::CalculateComfortability() {
-	// comfortability and consistency
-	for (int i = 0; i < candidates_.size(); i++) {
-		float s = 0.0f;
-		float comfort = 0.0f;
-		float consistent = 0.0f;
-		candidates_[i].SetMaxCurvature(0.0f);
-		while (s < s_max_) {
-			CurveInfo base_ca = path_.GetCurvatureAndAngle(s_start_ + s);
-			CurveInfo ca = InfoOfCurve(candidates_[i], s, base_ca);
-			if (!first_iter_) {
-				CurveInfo last_ca = InfoOfCurve(last_selected_, s, base_ca);
-				consistent += (float)sqrt(pow(last_ca.theta - ca.theta, 2.0));
+void Planner::TabulatePathSamples() {
+	// everything at a sample that does not depend on the candidate, computed once per cycle
+	// s only increases, so the path lookups walk the segments with cursors
+	samples_.clear();
+	int cursor = -1;
+	int theta_cursor = -1;
+	float s = 0.0f;
+	while (s < s_max_) {
+		PathSample sample;
+		sample.s = s;
+		CurveInfo base_ca = path_.GetCurvatureAndAngle(s_start_ + s, cursor);
+		sample.curvature = base_ca.curvature;
+		sample.theta = path_.GetTheta(s, theta_cursor);
+		sample.last_theta = first_iter_ ? 0.0f : InfoOfCurve(last_selected_, s, base_ca).theta;
+		sample.frame = s < s_no_coll_before_ ? PathFrame() : path_.GetFrameAt(s_start_ + s, cursor);
+		samples_.push_back(sample);
+		s += ds_;
+	}
+}
+
+void Planner::CalculateComfortability(int first) {
+	// comfortability and consistency of candidates first and up,
+	// each thread runs the fan kernels over its own range of candidates
+	int nc = (int)candidates_.size();
+	rho_buf_.resize(nc);
+	drho_buf_.resize(nc);
+	d2rho_buf_.resize(nc);
+	curv_buf_.resize(nc);
+	sum_buf_.assign(nc, 0.0f);
+	sum2_buf_.assign(nc, 0.0f);
+	max_buf_.assign(nc, 0.0f);
+	ParallelFor(first, nc, [this](int begin, int end) { ComfortabilityRange(begin, end); });
+}
+
+void Planner::ComfortabilityRange(int first, int last) {
+	// s is the outer loop so the candidate terms at each s run over the whole range at once
+	float *rho = rho_buf_.data();
+	float *drho = drho_buf_.data();
+	float *d2rho = d2rho_buf_.data();
+	float *curv = curv_buf_.data();
+	float *comfort = sum_buf_.data();
+	float *consistent = sum2_buf_.data();
+	float *max_curv = max_buf_.data();
+	// the rho buffer is reused for the candidate heading
+	float *heading = rho_buf_.data();
+	// unless the lattice is sampled adaptively, candidate i is lattice point i,
+	// and the rows of the template are read in place instead of gathered
+	const bool in_place = template_ && lattice_stride_ == 1;
+	for (int k = 0; k < (int)samples_.size(); k++) {
+		const PathSample &sample = samples_[k];
+		const float k0 = sample.curvature;
+		const float tp = sample.theta;
+		const float *r = rho;
+		const float *dr = drho;
+		const float *d2r = d2rho;
+		if (in_place) {
+			const int np = template_->num_points;
+			r = template_->rho.data() + k * np;
+			dr = template_->drho.data() + k * np;
+			d2r = template_->d2rho.data() + k * np;
+		}
+		else if (template_) {
+			const int np = template_->num_points;
+			const float *t_rho = template_->rho.data() + k * np;
+			const float *t_drho = template_->drho.data() + k * np;
+			const float *t_d2rho = template_->d2rho.data() + k * np;
+			const int *index = lattice_index_.data();
+			for (int i = first; i < last; i++) {
+				rho[i] = t_rho[index[i]];
+				drho[i] = t_drho[index[i]];
+				d2rho[i] = t_d2rho[index[i]];
+			}
+		}
+		else {
+			fan_.Evaluate(sample.s, rho, drho, d2rho, first, last);
+		}
+		// The loops are branch free, sqrtf does not set errno in this file, and each loop
+		// writes few enough arrays for the run-time alias checks, so they are vectorized.
+		for (int i = first; i < last; i++) {
+			float b = 1.0f - r[i] * k0;
+			float B = copysignf(1.0f, b);
+			float drds2 = dr[i] * dr[i];
+			float A = sqrtf(drds2 + b * b);
+			float curvature = (B / A)*(k0 + (b*d2r[i] + k0*drds2) / (A*A));
+			curv[i] = curvature;
+			heading[i] = tp + A*curvature;
+		}
+		for (int i = first; i < last; i++) {
+			comfort[i] += curv[i]*curv[i];
+			max_curv[i] = std::max(max_curv[i], fabsf(curv[i]));
+		}
+		if (!first_iter_) {
+			const float last_theta = sample.last_theta;
+			for (int i = first; i < last; i++) {
+				consistent[i] += fabsf(last_theta - heading[i]);
 			}
-			comfort += ca.curvature*ca.curvature;
-			if (fabs(ca.curvature) > candidates_[i].GetMaxCurvature())candidates_[i].SetMaxCurvature(fabs(ca.curvature));
-			s += ds_;
 		}
-		float c_tot = a_ * comfort * ds_ + b_*consistent * ds_ / s_max_;
+	}
+	for (int i = first; i < last; i++) {
+		candidates_[i].SetMaxCurvature(max_curv[i]);
+		float c_tot = a_ * comfort[i] * ds_ + b_*consistent[i] * ds_ / s_max_;
 		candidates_[i].SetComfortability(c_tot);
 	}
 }
 
-void Planner::CalculateDynamicSafety(avt_341::msg::Odometry odom) {
-	for (int i = 0; i < candidates_.size(); i++) {
-		float km = candidates_[i].GetMaxCurvature();
-		float vk = (float)sqrt(alpha_max_ / km);
-		float fs = candidates_[i].GetStaticSafety();
-		float vr = (1.0f - k_safe_ * fs*fs)*v_curve_;
-		float v_lim = std::min(vr, vk);
-		candidates_[i].SetDynamicSafety(0.0f);
+void Planner::CalculateDynamicSafety(const avt_341::msg::Odometry &odom, int first) {
+	int nc = (int)candidates_.size();
+	if (dynamic_obstacles_.Empty()) {
+		for (int i = first; i < nc; i++) candidates_[i].SetDynamicSafety(0.0f);
+		return;
 	}
+	// arrival times assume the current speed, with a floor so a stopped vehicle still looks ahead
+	float speed = (float)sqrt(odom.twist.twist.linear.x*odom.twist.twist.linear.x + odom.twist.twist.linear.y*odom.twist.twist.linear.y);
+	speed = std::max(speed, 0.5f);
+	// The hash is rebuilt each cycle, candidates added later in the cycle reuse it.
+	// Distances beyond its influence are reported as the influence, so it is grown by how far
+	// the vehicle and the fastest obstacle can close in between two coarse samples, letting
+	// the coarse to fine check skip the fine samples of stretches far from any obstacle.
+	if (first == 0) {
+		const float slice_dt = 0.5f;
+		float ds_max = 0.0f;
+		for (int k = 0; k + 1 < (int)samples_.size(); k++) ds_max = std::max(ds_max, samples_[k + 1].s - samples_[k].s);
+		float ds_coarse = dynamic_stride_ * ds_max;
+		// candidates at an offset can be longer than the centerline, allow half as much again
+		float margin = 0.5f*(1.2f*1.5f*ds_coarse + dynamic_obstacles_.GetMaxSpeed()*ds_coarse / speed);
+		float influence = dynamic_radius_ + std::max(dynamic_cost_dist_, 0.0f) + margin;
+		dynamic_obstacles_.Build(influence, dynamic_horizon_, slice_dt, std::max(1.0f, influence));
+	}
+	ParallelFor(first, nc, [this, speed](int begin, int end) {
+		for (int i = begin; i < end; i++) candidates_[i].SetDynamicSafety(DynamicSafetyOf(i, speed));
+	});
 }
 
-void Planner::DilateGrid(avt_341::msg::OccupancyGrid &grid, int x, float llx, float lly, float urx, float ury){
-	//std::cerr << "Grid Size: " << grid.info.width << ", " << grid.info.height << std::endl;
-	//std::cerr << "Grid Origin: " << grid.info.origin.position.x << ", " << grid.info.origin.position.y << std::endl;
-	//std::cerr << "Grid Resolution: " << grid.info.resolution << std::endl;
-	std::vector<int8_t> new_data = grid.data;
+float Planner::DynamicSafetyOf(int i, float speed) const {
+	// samples from the first checked one until the vehicle would reach them after the horizon
+	const int k0 = check_first_;
+	int k1 = k0;
+	while (k1 < (int)samples_.size() && samples_[k1].s <= speed * dynamic_horizon_) k1++;
+	if (k1 <= k0) return 0.0f;
+
+	float x[2], y[2], t[2], dist[2];
+	float worst = 0.0f;
+	auto sample = [&](int k, int slot) {
+		const PathFrame &frame = samples_[k].frame;
+		float rho = SampleRho(i, k);
+		x[slot] = frame.point.x - frame.tangent.y*rho;
+		y[slot] = frame.point.y + frame.tangent.x*rho;
+		t[slot] = samples_[k].s / speed;
+		dist[slot] = dynamic_obstacles_.Distance(x[slot], y[slot], t[slot]) - dynamic_radius_;
+		float cost = 0.0f;
+		if (dist[slot] <= 0.0f) cost = 1.0f;
+		else if (dynamic_cost_dist_ > 0.0f) cost = std::max(0.0f, 1.0f - dist[slot] / dynamic_cost_dist_);
+		worst = std::max(worst, cost);
+	};
+
+	// coarse to fine in time: samples between two coarse samples are only checked when
+	// the distance at either end, less how far the vehicle and the fastest obstacle can
+	// move towards each other in between, is within the cost distance. The reach assumes
+	// the arc length of the candidate over a stride is at most 1.2 times its chord, which
+	// holds for smooth candidates at the default strides but is not guaranteed, so the skip
+	// is a heuristic and a stride of 1 checks every sample.
+	const int stride = dynamic_stride_;
+	const float max_speed = dynamic_obstacles_.GetMaxSpeed();
+	sample(k0, 0);
+	for (int ka = k0; ka < k1 - 1 && worst < 1.0f; ) {
+		int kb = std::min(ka + stride, k1 - 1);
+		sample(kb, 1);
+		if (kb - ka > 1) {
+			float chord = sqrtf((x[1] - x[0])*(x[1] - x[0]) + (y[1] - y[0])*(y[1] - y[0]));
+			// assumed, not bounded: the candidate is smooth over a few samples, so its arc length is close to the chord
+			float reach = 0.5f*(1.2f*chord + max_speed*(t[1] - t[0]));
+			if (std::min(dist[0], dist[1]) - reach < dynamic_cost_dist_) {
+				float x_b = x[1], y_b = y[1], t_b = t[1], dist_b = dist[1];
+				for (int k = ka + 1; k < kb && worst < 1.0f; k++) sample(k, 1);
+				x[1] = x_b;
+				y[1] = y_b;
+				t[1] = t_b;
+				dist[1] = dist_b;
+			}
+		}
+		x[0] = x[1];
+		y[0] = y[1];
+		t[0] = t[1];
+		dist[0] = dist[1];
+		ka = kb;
+	}
+	return worst;
+}
+
+void Planner::SetGrid(avt_341::msg::OccupancyGridConstPtr grid) {
+	grid_msg_ = grid;
+	grid_ = grid ? GridView(*grid, grid->data.data()) : GridView();
+	grid_generation_++;
+}
+
+void Planner::SetSegmentationGrid(avt_341::msg::OccupancyGridConstPtr grid) {
+	segmentation_grid_msg_ = grid;
+	segmentation_grid_ = grid ? GridView(*grid, grid->data.data()) : GridView();
+	segmentation_generation_++;
+}
+
+void Planner::DilateGrid(int x, float llx, float lly, float urx, float ury) {
+	if (x <= 0 || !grid_msg_ || grid_.Empty()) return;
+	GridView raw(*grid_msg_, grid_msg_->data.data());
+	DilateGrid(raw, x, llx, lly, urx, ury, dilated_grid_, grid_);
+	grid_generation_++;
+}
+
+void Planner::DilateSegmentationGrid(int x, float llx, float lly, float urx, float ury) {
+	if (x <= 0 || !segmentation_grid_msg_ || segmentation_grid_.Empty()) return;
+	GridView raw(*segmentation_grid_msg_, segmentation_grid_msg_->data.data());
+	DilateGrid(raw, x, llx, lly, urx, ury, dilated_segmentation_grid_, segmentation_grid_);
+	segmentation_generation_++;
+}
+
+void Planner::RunningMax(const int8_t *in, int n, int r, int8_t *out, std::vector<int8_t> &pad, std::vector<int8_t> &g, std::vector<int8_t> &h) {
+	// van Herk / Gil-Werman running maximum with a window of w = 2r+1.
+	// The line is padded by r cells on each side, split into blocks of w cells,
+	// and the maximum of any window is the max of a block suffix and a block prefix.
+	const int w = 2 * r + 1;
+	const int m = n + 2 * r;
+	pad.resize(m);
+	g.resize(m);
+	h.resize(m);
+	for (int k = 0; k < r; k++) {
+		pad[k] = std::numeric_limits<int8_t>::lowest();
+		pad[m - 1 - k] = std::numeric_limits<int8_t>::lowest();
+	}
+	std::copy(in, in + n, pad.begin() + r);
+	for (int k = 0; k < m; k++) {
+		g[k] = (k % w == 0) ? pad[k] : std::max(g[k - 1], pad[k]);
+	}
+	for (int k = m - 1; k >= 0; k--) {
+		h[k] = (k == m - 1 || (k + 1) % w == 0) ? pad[k] : std::max(h[k + 1], pad[k]);
+	}
+	for (int k = 0; k < n; k++) {
+		out[k] = std::max(h[k], g[k + w - 1]);
+	}
+}
 
-	int ix = (int)floor((llx - grid.info.origin.position.x) / grid.info.resolution);
+void Planner::DilateGrid(const GridView &grid, int x, float llx, float lly, float urx, float ury, std::vector<int8_t> &window, GridView &dilated){
+	// only the region is written, to the window buffer, and the view
+	// reads the cells outside of it from the received grid
+	dilated = grid;
+
+	int ix = (int)floor((llx - grid.origin_x) / grid.resolution);
 	if(ix < 0) {ix = 0;}
-	int iy = (int)floor((lly - grid.info.origin.position.y) / grid.info.resolution);
+	int iy = (int)floor((lly - grid.origin_y) / grid.resolution);
 	if(iy < 0) {iy = 0;}
-	int imax_x = (int)ceil((urx - grid.info.origin.position.x) / grid.info.resolution);
-	if(imax_x > grid.info.width) {imax_x = grid.info.width;}
-	int imax_y = (int)ceil((ury - grid.info.origin.position.y) / grid.info.resolution);
-	if(imax_y > grid.info.height) {imax_x = grid.info.height;}
-	//std::cerr << "Dilate Grid: (" << ix << ", " << iy << ") to (" << imax_x << ", " << imax_y << ")" << std::endl;
-
-	for (int i=ix+x;i<imax_x-x;i++){
-		for (int j=iy+x;j<imax_y-x;j++){
-			int n = i*grid.info.height+j;
-			for (int ii=-x;ii<=x;ii++){
-				for (int jj=-x;jj<=x;jj++){
-					int iii = i+ii;
-					int jjj = j+jj;
-					int nd = iii*grid.info.height+jjj;
-					new_data[n] = std::max(new_data[n],grid.data[nd]);
-				}
-			}
+	int imax_x = (int)ceil((urx - grid.origin_x) / grid.resolution);
+	if(imax_x > grid.width) {imax_x = grid.width;}
+	int imax_y = (int)ceil((ury - grid.origin_y) / grid.resolution);
+	if(imax_y > grid.height) {imax_y = grid.height;}
+	if (ix >= imax_x || iy >= imax_y) return;
+	window.resize((imax_x - ix) * (imax_y - iy));
+
+	// The square mask is separable, so dilate along y and then along x.
+	// Cells outside the region are read (but not written) so the region edges see their neighbors.
+	int ilo = std::max(0, ix - x);
+	int ihi = std::min(grid.width, imax_x + x);
+	int ny = imax_y - iy;
+	int nx = ihi - ilo;
+	int jlo = std::max(0, iy - x);
+	int jhi = std::min(grid.height, imax_y + x);
+	dilate_tmp_.resize(nx * ny);
+	dilate_line_.resize(std::max(nx, jhi - jlo));
+
+	// pass along y, columns are contiguous. Store transposed so the x pass reads contiguous rows.
+	for (int i = ilo; i < ihi; i++) {
+		RunningMax(grid.data + i * grid.height + jlo, jhi - jlo, x, dilate_line_.data(), dilate_pad_, dilate_g_, dilate_h_);
+		for (int j = iy; j < imax_y; j++) {
+			dilate_tmp_[(j - iy) * nx + (i - ilo)] = dilate_line_[j - jlo];
+		}
+	}
+	// pass along x
+	for (int j = iy; j < imax_y; j++) {
+		RunningMax(dilate_tmp_.data() + (j - iy) * nx, nx, x, dilate_line_.data(), dilate_pad_, dilate_g_, dilate_h_);
+		for (int i = ix; i < imax_x; i++) {
+			window[(i - ix) * ny + (j - iy)] = dilate_line_[i - ilo];
+		}
+	}
+	dilated.SetWindow(window.data(), ix, iy, imax_x, imax_y);
+}
+
+void Planner::DistanceTransform1D(const float *f, int n, float *d, int *v, float *z) {
+	// squared Euclidean distance transform of a sampled function, see
+	// Felzenszwalb & Huttenlocher, "Distance Transforms of Sampled Functions", 2012
+	int k = 0;
+	v[0] = 0;
+	z[0] = -std::numeric_limits<float>::max();
+	z[1] = std::numeric_limits<float>::max();
+	for (int q = 1; q < n; q++) {
+		float s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2.0f*(q - v[k]));
+		while (s <= z[k]) {
+			k--;
+			s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2.0f*(q - v[k]));
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = std::numeric_limits<float>::max();
+	}
+	k = 0;
+	for (int q = 0; q < n; q++) {
+		while (z[k + 1] < q) k++;
+		float dq = (float)(q - v[k]);
+		d[q] = dq*dq + f[v[k]];
+	}
+}
+
+void Planner::CalculateClearance(const GridView &grid, int wx0, int wy0, int wx1, int wy1) {
+	// distance in meters from each cell of the window to the nearest occupied cell
+	const float far = 1.0E10f;
+	int nx = wx1 - wx0;
+	int ny = wy1 - wy0;
+	int nmax = std::max(nx, ny);
+	clearance_.resize(grid.Size());
+	dt_tmp_.resize(nx * ny);
+	dt_f_.resize(nmax);
+	dt_d_.resize(nmax);
+	dt_v_.resize(nmax);
+	dt_z_.resize(nmax + 1);
+	// pass along y, columns are contiguous. Store transposed for the x pass.
+	for (int i = wx0; i < wx1; i++) {
+		for (int j = wy0; j < wy1; j++) {
+			dt_f_[j - wy0] = grid.At(i, j) > 0 ? 0.0f : far;
+		}
+		DistanceTransform1D(dt_f_.data(), ny, dt_d_.data(), dt_v_.data(), dt_z_.data());
+		for (int j = 0; j < ny; j++) {
+			dt_tmp_[j * nx + (i - wx0)] = dt_d_[j];
 		}
 	}
-	grid.data = new_data;
-}
-
-void Planner::CalculateStaticSafetyAndSegCost(const avt_341::msg::OccupancyGrid & grid, const avt_341::msg::OccupancyGrid & grid_seg) {
-	bool has_segmentation = grid_seg.info.height>0 && grid_seg.info.width>0;
-	for (int i = 0; i < candidates_.size(); i++) {
-		float s = s_no_coll_before_;
-		float stat_safe = 0.0f;
-		float traj_seg_cost = 0.0;
-		while (s < s_max_) {
-			float rho = candidates_[i].At(s);
-			if (fabs(rho) > rho_max_)candidates_[i].SetOutOfBounds(true);
-			utils::vec2 p = path_.ToCartesian(s_start_ + s, rho);
-			int ix = (int)floor((p.x - grid.info.origin.position.x) / grid.info.resolution);
-			int iy = (int)floor((p.y - grid.info.origin.position.y) / grid.info.resolution);
-			if (ix >= 0 && ix < (int)grid.info.width && iy >= 0 && iy < (int)grid.info.height) {
-				int ndx = ix * grid.info.height + iy;
-				stat_safe += grid.data[ndx];
-				traj_seg_cost += (has_segmentation ? grid_seg.data[ndx] : 0.0f);
+	// pass along x
+	for (int j = wy0; j < wy1; j++) {
+		DistanceTransform1D(dt_tmp_.data() + (j - wy0) * nx, nx, dt_d_.data(), dt_v_.data(), dt_z_.data());
+		for (int i = wx0; i < wx1; i++) {
+			clearance_[i * grid.height + j] = grid.resolution * sqrtf(dt_d_[i - wx0]);
+		}
+	}
+}
+
+void Planner::SampleGridPoint(int i, int k, float &gx, float &gy) const {
+	// point of candidate i at sample k, in continuous cell coordinates of the check grid
+	const GridView &grid = check_grid_;
+	const PathFrame &frame = samples_[k].frame;
+	float rho = SampleRho(i, k);
+	float x = frame.point.x - frame.tangent.y*rho;
+	float y = frame.point.y + frame.tangent.x*rho;
+	const float inv_res = 1.0f / grid.resolution;
+	gx = (x - grid.origin_x) * inv_res;
+	gy = (y - grid.origin_y) * inv_res;
+}
+
+template <typename F>
+void Planner::TraverseCells(int i, F visit) const {
+	// Visits every cell crossed by the polyline through the checked samples of candidate i
+	// exactly once and in order, stopping when visit returns false. Each segment is walked with
+	// the traversal of Amanatides & Woo, "A Fast Voxel Traversal Algorithm for Ray Tracing", 1987.
+	// visit(ix, iy, heading) gets cell indices that may be outside the grid and the heading of the segment.
+	const int ns = check_count_;
+	if (ns == 0) return;
+	float x0, y0;
+	SampleGridPoint(i, check_first_, x0, y0);
+	int ix = (int)floorf(x0);
+	int iy = (int)floorf(y0);
+	if (ns == 1) {
+		const PathFrame &frame = samples_[check_first_].frame;
+		visit(ix, iy, atan2f(frame.tangent.y, frame.tangent.x) + atanf(SampleSlope(i, check_first_)));
+		return;
+	}
+	const float inf = std::numeric_limits<float>::max();
+	for (int k = 1; k < ns; k++) {
+		float x1, y1;
+		SampleGridPoint(i, check_first_ + k, x1, y1);
+		float dx = x1 - x0;
+		float dy = y1 - y0;
+		float heading = atan2f(dy, dx);
+		if (k == 1 && !visit(ix, iy, heading)) return;
+		int ex = (int)floorf(x1);
+		int ey = (int)floorf(y1);
+		int step_x = dx > 0.0f ? 1 : -1;
+		int step_y = dy > 0.0f ? 1 : -1;
+		// parameter along the segment of the next x and y cell boundaries, and between boundaries
+		float t_delta_x = dx != 0.0f ? fabsf(1.0f / dx) : inf;
+		float t_delta_y = dy != 0.0f ? fabsf(1.0f / dy) : inf;
+		float t_max_x = dx > 0.0f ? (ix + 1 - x0) / dx : (dx < 0.0f ? (x0 - ix) / -dx : inf);
+		float t_max_y = dy > 0.0f ? (iy + 1 - y0) / dy : (dy < 0.0f ? (y0 - iy) / -dy : inf);
+		// the number of crossings is known, so rounding in t cannot make the walk overshoot
+		int crossings = abs(ex - ix) + abs(ey - iy);
+		for (int n = 0; n < crossings; n++) {
+			if (t_max_x < t_max_y) {
+				ix += step_x;
+				t_max_x += t_delta_x;
+			}
+			else {
+				iy += step_y;
+				t_max_y += t_delta_y;
 			}
-			s += ds_;
+			if (!visit(ix, iy, heading)) return;
 		}
-		if (stat_safe > 0) {
-			candidates_[i].SetHitsObstacle(true);
-			candidates_[i].SetStaticSafety(1.0f);
+		ix = ex;
+		iy = ey;
+		x0 = x1;
+		y0 = y1;
+	}
+}
+
+void Planner::PrepareStaticSafety(const GridView &grid, const GridView &grid_seg, bool keep_results) {
+	check_grid_ = grid;
+	// the segmentation grid is indexed with the cells of the occupancy grid
+	bool has_segmentation = !grid_seg.Empty() && grid_seg.width == grid.width && grid_seg.height == grid.height;
+	check_seg_grid_ = has_segmentation ? grid_seg : GridView();
+	const float ox = grid.origin_x;
+	const float oy = grid.origin_y;
+	const float inv_res = 1.0f / grid.resolution;
+
+	// obstacles are checked at the tabulated samples from s_no_coll_before_ on
+	check_first_ = 0;
+	while (check_first_ < (int)samples_.size() && samples_[check_first_].s < s_no_coll_before_) check_first_++;
+	check_count_ = (int)samples_.size() - check_first_;
+	const PathSample *check_samples = samples_.data() + check_first_;
+
+	// nothing is evaluated yet, unless the results of the previous cycles are reused
+	if (!keep_results) {
+		raw_static_.clear();
+		raw_seg_.clear();
+		static_done_.clear();
+		raw_hits_.clear();
+	}
+	float max_rho = ExtendStaticSafety(0);
+	UpdateNearestSampled();
+
+	// clearance field over the planning window, padded so obstacles
+	// just outside the window still count within the distances of interest
+	if (check_count_ > 0) {
+		float pad = max_rho + std::max(collision_radius_ + clearance_cost_dist_, footprint_.MaskRadius(grid.resolution)) + grid.resolution;
+		float llx = std::numeric_limits<float>::max();
+		float lly = std::numeric_limits<float>::max();
+		float urx = std::numeric_limits<float>::lowest();
+		float ury = std::numeric_limits<float>::lowest();
+		for (int k = 0; k < check_count_; k++) {
+			const utils::vec2 &p = check_samples[k].frame.point;
+			llx = std::min(llx, p.x);
+			lly = std::min(lly, p.y);
+			urx = std::max(urx, p.x);
+			ury = std::max(ury, p.y);
 		}
-		else {
-			candidates_[i].SetHitsObstacle(false);
-			candidates_[i].SetStaticSafety(0.0f);
+		int wx0 = std::max(0, (int)floorf((llx - pad - ox) * inv_res));
+		int wy0 = std::max(0, (int)floorf((lly - pad - oy) * inv_res));
+		int wx1 = std::min(grid.width, (int)ceilf((urx + pad - ox) * inv_res));
+		int wy1 = std::min(grid.height, (int)ceilf((ury + pad - oy) * inv_res));
+		// the field of the same grid over a window containing this one is still valid
+		bool contained = clearance_valid_ && clearance_generation_ == grid_generation_ && clearance_window_[0] <= wx0 &&
+			clearance_window_[1] <= wy0 && clearance_window_[2] >= wx1 && clearance_window_[3] >= wy1;
+		if (wx0 >= wx1 || wy0 >= wy1) {
+			check_count_ = 0;
+		}
+		else if (!contained) {
+			CalculateClearance(grid, wx0, wy0, wx1, wy1);
+			clearance_valid_ = true;
+			clearance_generation_ = grid_generation_;
+			clearance_window_[0] = wx0;
+			clearance_window_[1] = wy0;
+			clearance_window_[2] = wx1;
+			clearance_window_[3] = wy1;
+		}
+	}
+	if (footprint_.Enabled()) footprint_.Update(grid, grid_generation_);
+}
+
+float Planner::ExtendStaticSafety(int first) {
+	// marks out of bounds candidates and returns the largest offset of any of them
+	int nc = (int)candidates_.size();
+	raw_static_.resize(nc, 0.0f);
+	raw_seg_.resize(nc, 0.0f);
+	static_done_.resize(nc, 0);
+	raw_hits_.resize(nc, 0);
+	float max_rho = 0.0f;
+	for (int i = first; i < nc; i++) {
+		float mr = template_ ? template_->max_abs_rho[lattice_index_[i]] : fan_.MaxAbsRho(i, s_no_coll_before_, s_max_);
+		if (mr > rho_max_) candidates_[i].SetOutOfBounds(true);
+		max_rho = std::max(max_rho, mr);
+	}
+	return max_rho;
+}
+
+float Planner::RawStaticSafety(int i) {
+	if (static_done_[i]) {
+		candidates_[i].SetHitsObstacle(raw_hits_[i] != 0);
+		return raw_static_[i];
+	}
+	const int width = check_grid_.width;
+	const int height = check_grid_.height;
+	const bool use_footprint = footprint_.Enabled();
+	const float footprint_radius = footprint_.MaskRadius(check_grid_.resolution);
+	const float *clearance = clearance_.data();
+
+	// walk the cells under the candidate, obstacle checks stop at the first collision
+	float min_clearance = std::numeric_limits<float>::max();
+	bool hits_obstacle = false;
+	TraverseCells(i, [&](int ix, int iy, float heading) {
+		if (ix < 0 || ix >= width || iy < 0 || iy >= height) return true;
+		float c = clearance[ix * height + iy];
+		min_clearance = std::min(min_clearance, c);
+		if (c <= collision_radius_) {
+			hits_obstacle = true;
+			return false;
+		}
+		// the clearance is the broad phase, only cells with an obstacle
+		// inside the radius of the masks need the footprint mask
+		if (use_footprint && c <= footprint_radius && footprint_.Collides(ix, iy, footprint_.HeadingBin(heading))) {
+			hits_obstacle = true;
+			return false;
 		}
-		candidates_[i].SetSegmentationCost(traj_seg_cost);
-	}
-
-	// now blend
-	if(use_blend_){
-		std::vector<float> fs;
-		std::vector<float> fseg;
-		fs.resize(candidates_.size(),0.0f);
-		fseg.resize(candidates_.size(),0.0f);
-		for (int i = 0; i < candidates_.size(); i++) {
-		float fcount = 0.0f;
-		for (int k = -averaging_window_size_; k <= averaging_window_size_; k++) {
-			int ndx = i + k;
-			if (ndx >= 0 && ndx < candidates_.size()) {
-			fs[i] += candidates_[ndx].GetStaticSafety();
-			fseg[i] += candidates_[ndx].GetSegmentationCost();
+		return true;
+	});
+	float traj_seg_cost = 0.0f;
+	if (!check_seg_grid_.Empty()) {
+		const GridView &seg_grid = check_seg_grid_;
+		TraverseCells(i, [&](int ix, int iy, float /*heading*/) {
+			if (ix >= 0 && ix < width && iy >= 0 && iy < height) traj_seg_cost += seg_grid.At(ix, iy);
+			return true;
+		});
+	}
+	float static_safety = 0.0f;
+	if (hits_obstacle) {
+		static_safety = 1.0f;
+	}
+	else if (clearance_cost_dist_ > 0.0f) {
+		float margin = min_clearance - collision_radius_;
+		static_safety = std::max(0.0f, 1.0f - margin / clearance_cost_dist_);
+	}
+	candidates_[i].SetHitsObstacle(hits_obstacle);
+	raw_hits_[i] = hits_obstacle ? 1 : 0;
+	raw_static_[i] = static_safety;
+	raw_seg_[i] = traj_seg_cost;
+	static_done_[i] = 1;
+	return static_safety;
+}
+
+void Planner::EvaluateStaticSafety(int first) {
+	// candidates write only their own memoized results, so ranges run in parallel
+	ParallelFor(first, (int)candidates_.size(), [this](int begin, int end) {
+		for (int i = begin; i < end; i++) RawStaticSafety(i);
+	});
+}
+
+void Planner::BlendStaticSafety(int i) {
+	// averages over the neighbours of the candidate, evaluating them on demand
+	if (!use_blend_) {
+		candidates_[i].SetStaticSafety(RawStaticSafety(i));
+		candidates_[i].SetSegmentationCost(raw_seg_[i]);
+		return;
+	}
+	// the window is over neighbouring end offsets of the full fan with the same horizon,
+	// offsets that were not sampled take the value of the nearest sampled one
+	float fs = 0.0f;
+	float fseg = 0.0f;
+	float fcount = 0.0f;
+	int n = (int)lattice_rho_.size();
+	int row = lattice_index_[i] / n * n;
+	int j = lattice_index_[i] % n;
+	for (int k = -averaging_window_size_; k <= averaging_window_size_; k++) {
+		int nj = j + k;
+		if (nj >= 0 && nj < n) {
+			int ndx = lattice_nearest_[row + nj];
+			fs += RawStaticSafety(ndx);
+			fseg += raw_seg_[ndx];
 			fcount += 1.0f;
-			}
 		}
-		fs[i] = fs[i] / fcount;
-		fseg[i] = fseg[i] / fcount;
+	}
+	candidates_[i].SetStaticSafety(fs / fcount);
+	candidates_[i].SetSegmentationCost(fseg / fcount);
+}
+
+void Planner::UpdateNearestSampled() {
+	// nearest sampled end offset of every offset of the full fan within each horizon, the lower one on ties
+	int n = (int)lattice_rho_.size();
+	lattice_nearest_.assign(lattice_candidate_.size(), -1);
+	for (int row = 0; row + n <= (int)lattice_candidate_.size(); row += n) {
+		const int *sampled = lattice_candidate_.data() + row;
+		int *nearest_sampled = lattice_nearest_.data() + row;
+		int last = -1;
+		for (int j = 0; j < n; j++) {
+			if (sampled[j] >= 0) last = j;
+			nearest_sampled[j] = last;
 		}
-		for (int i = 0; i < candidates_.size(); i++) {
-		candidates_[i].SetStaticSafety(fs[i]);
-		candidates_[i].SetSegmentationCost(fseg[i]);
+		int next = -1;
+		for (int j = n - 1; j >= 0; j--) {
+			if (sampled[j] >= 0) next = j;
+			int left = nearest_sampled[j];
+			int nearest = left;
+			if (left < 0 || (next >= 0 && next - j < j - left)) nearest = next;
+			nearest_sampled[j] = sampled[nearest];
 		}
 	}
 }
 
-void Planner::CalculateRhoCost() {
-	for (int i = 0; i < candidates_.size(); i++) {
-		float rho_final = candidates_[i].At(s_max_);
+void Planner::CalculateStaticSafetyAndSegCost(const GridView &grid, const GridView &grid_seg) {
+	PrepareStaticSafety(grid, grid_seg, false);
+	EvaluateStaticSafety(0);
+	int nc = (int)candidates_.size();
+	for (int i = 0; i < nc; i++) BlendStaticSafety(i);
+}
+
+void Planner::CalculateRhoCost(int first) {
+	int nc = (int)candidates_.size();
+	for (int i = first; i < nc; i++) {
+		float rho_final = template_ ? template_->rho_end[lattice_index_[i]] : candidates_[i].At(s_max_);
 		float rho_cost = (float)fabs(rho_final / rho_max_);
 		candidates_[i].SetRhoCost(rho_cost);
 	}
@@ -214,30 +853,208 @@ float Planner::GetTotalCostOfCandidate(int i) {
 	return cost;
 }
 
-bool Planner::CalculateCandidateCosts(avt_341::msg::OccupancyGrid grid, avt_341::msg::OccupancyGrid segmentation_grid, avt_341::msg::Odometry odom) {
-
-	CalculateStaticSafetyAndSegCost(grid, segmentation_grid);
-	CalculateComfortability();
-	CalculateRhoCost();
-	CalculateDynamicSafety(odom);
+int Planner::SelectCandidate(bool in_bounds_only) {
+	int lowest_index = -1;
+	float lowest_cost = std::numeric_limits<float>::max();
+	int nc = (int)candidates_.size();
+	for (int i = 0; i < nc; i++) {
+		float cost = GetTotalCostOfCandidate(i);
+		if (cost < lowest_cost && !candidates_[i].HitsObstacle() && (!in_bounds_only || !candidates_[i].IsOutOfBounds())) {
+			lowest_cost = cost;
+			lowest_index = i;
+		}
+	}
+	return lowest_index;
+}
 
+int Planner::SelectCandidateBranchAndBound(bool in_bounds_only) {
+	// candidates are scored in order of their lower bound, the cost without static safety,
+	// until the lower bound exceeds the best cost found
 	int lowest_index = -1;
 	float lowest_cost = std::numeric_limits<float>::max();
-	for (int i = 0; i < candidates_.size(); i++) {
+	for (int n = 0; n < (int)order_buf_.size(); n++) {
+		int i = order_buf_[n];
+		if (lower_bound_buf_[i] > lowest_cost) break;
+		if (in_bounds_only && candidates_[i].IsOutOfBounds()) continue;
+		RawStaticSafety(i);
+		if (candidates_[i].HitsObstacle()) continue;
+		BlendStaticSafety(i);
 		float cost = GetTotalCostOfCandidate(i);
-		if (cost < lowest_cost && !candidates_[i].HitsObstacle() && !candidates_[i].IsOutOfBounds()) {
+		// ties go to the lower index, as in the exhaustive search
+		if (cost < lowest_cost || (cost == lowest_cost && i < lowest_index)) {
 			lowest_cost = cost;
 			lowest_index = i;
 		}
 	}
-	if (lowest_index == -1) { // pick a path that leaves the lane
-		for (int i = 0; i < candidates_.size(); i++) {
-			float cost = GetTotalCostOfCandidate(i);
-			if (cost < lowest_cost && !candidates_[i].HitsObstacle()) {
-				lowest_cost = cost;
-				lowest_index = i;
+	return lowest_index;
+}
+
+int Planner::SampleAdaptively(const avt_341::msg::Odometry &odom) {
+	// refine the coarse fan around the best candidates and the obstacle boundaries,
+	// halving the spacing of the end offsets each level until the full fan spacing or the budget is reached.
+	// Refinement stays within the horizon of each seed.
+	const int refine_count = 3;
+	const int n = (int)lattice_rho_.size();
+	int evaluations = (int)candidates_.size();
+	int stride = lattice_stride_;
+	std::vector<int> order;
+	std::vector<int> seeds;
+	while (stride > 1 && evaluations < adaptive_budget_) {
+		int half = stride / 2;
+		int nc = (int)candidates_.size();
+		seeds.clear();
+		order.clear();
+		UpdateNearestSampled();
+		EvaluateStaticSafety(0);
+		for (int i = 0; i < nc; i++) {
+			BlendStaticSafety(i);
+			GetTotalCostOfCandidate(i);
+			if (!candidates_[i].HitsObstacle()) order.push_back(i);
+		}
+		// best few collision free candidates, in bounds first
+		std::sort(order.begin(), order.end(), [this](int a, int b) {
+			bool oa = candidates_[a].IsOutOfBounds();
+			bool ob = candidates_[b].IsOutOfBounds();
+			if (oa != ob) return ob;
+			return candidates_[a].GetCost() < candidates_[b].GetCost();
+		});
+		for (int k = 0; k < (int)order.size() && k < refine_count; k++) seeds.push_back(lattice_index_[order[k]]);
+		// neighbouring sampled offsets on either side of an obstacle
+		for (int row = 0; row < (int)lattice_candidate_.size(); row += n) {
+			int prev = -1;
+			for (int j = row; j < row + n; j++) {
+				int i = lattice_candidate_[j];
+				if (i < 0) continue;
+				if (prev >= 0 && candidates_[i].HitsObstacle() != candidates_[lattice_candidate_[prev]].HitsObstacle()) {
+					seeds.push_back(prev);
+					seeds.push_back(j);
+				}
+				prev = j;
 			}
 		}
+
+		int first_new = nc;
+		for (int k = 0; k < (int)seeds.size() && evaluations < adaptive_budget_; k++) {
+			for (int side = -1; side <= 1 && evaluations < adaptive_budget_; side += 2) {
+				int j = seeds[k] % n + side * half;
+				int index = seeds[k] - seeds[k] % n + j;
+				if (j < 0 || j >= n || lattice_candidate_[index] >= 0) continue;
+				AddCandidate(index);
+				evaluations++;
+			}
+		}
+		if ((int)candidates_.size() > first_new) {
+			CalculateComfortability(first_new);
+			CalculateRhoCost(first_new);
+			CalculateDynamicSafety(odom, first_new);
+			ExtendStaticSafety(first_new);
+		}
+		stride = half;
+	}
+
+	UpdateNearestSampled();
+	EvaluateStaticSafety(0);
+	for (int i = 0; i < (int)candidates_.size(); i++) BlendStaticSafety(i);
+	int lowest_index = SelectCandidate(true);
+	if (lowest_index == -1) { // pick a path that leaves the lane
+		lowest_index = SelectCandidate(false);
+	}
+	return lowest_index;
+}
+
+bool Planner::CanWarmStart() const {
+	if (warm_pose_delta_ <= 0.0f || !warm_valid_ || lattice_stride_ > 1) return false;
+	if (warm_cycles_ + 1 >= warm_refresh_cycles_) return false;
+	if (grid_generation_ != warm_grid_generation_ || segmentation_generation_ != warm_segmentation_generation_ ||
+		path_generation_ != warm_path_generation_) return false;
+	if ((int)candidates_.size() != warm_num_candidates_ || s_max_ != warm_s_max_ || ds_ != warm_ds_) return false;
+	// deltas from the last full evaluation, so slow drift cannot accumulate
+	if (fabsf(s_start_ - warm_s_start_) + fabsf(gen_rho_start_ - warm_rho_start_) > warm_pose_delta_) return false;
+	return fabsf(gen_theta_start_ - warm_theta_start_) <= warm_heading_delta_;
+}
+
+void Planner::SaveWarmStartReference() {
+	warm_valid_ = true;
+	warm_cycles_ = 0;
+	warm_grid_generation_ = grid_generation_;
+	warm_segmentation_generation_ = segmentation_generation_;
+	warm_path_generation_ = path_generation_;
+	warm_num_candidates_ = (int)candidates_.size();
+	warm_s_max_ = s_max_;
+	warm_ds_ = ds_;
+	warm_s_start_ = s_start_;
+	warm_rho_start_ = gen_rho_start_;
+	warm_theta_start_ = gen_theta_start_;
+}
+
+bool Planner::CalculateCandidateCosts(const avt_341::msg::Odometry &odom) {
+	if (grid_.Empty()) return false;
+
+	{
+		AVT_341_SCOPED_TIMER(timing_, STAGE_PATH_SAMPLES);
+		TabulatePathSamples();
+	}
+	if (template_ && template_->num_samples != (int)samples_.size()) template_ = nullptr;
+	{
+		AVT_341_SCOPED_TIMER(timing_, STAGE_COMFORT);
+		CalculateComfortability(0);
+	}
+	{
+		AVT_341_SCOPED_TIMER(timing_, STAGE_RHO_COST);
+		CalculateRhoCost(0);
+	}
+	// the candidates keep the grid checks of the previous cycles while the start barely moved
+	bool warm_start = CanWarmStart();
+	if (warm_start) warm_cycles_++;
+	else SaveWarmStartReference();
+	{
+		AVT_341_SCOPED_TIMER(timing_, STAGE_PREPARE_STATIC);
+		PrepareStaticSafety(grid_, segmentation_grid_, warm_start);
+	}
+	{
+		AVT_341_SCOPED_TIMER(timing_, STAGE_DYNAMIC_SAFETY);
+		CalculateDynamicSafety(odom, 0);
+	}
+
+	// the selection is timed as static safety, since it runs the grid checks
+	int lowest_index = -1;
+	if (lattice_stride_ > 1) {
+		AVT_341_SCOPED_TIMER(timing_, STAGE_STATIC_SAFETY);
+		// the coarse fan contains the outermost offsets, every refined candidate lies
+		// between them, so the clearance window prepared above covers all of them
+		lowest_index = SampleAdaptively(odom);
+	}
+	else if (prune_candidates_ && w_s_ >= 0.0f) {
+		AVT_341_SCOPED_TIMER(timing_, STAGE_STATIC_SAFETY);
+		int nc = (int)candidates_.size();
+		lower_bound_buf_.resize(nc);
+		order_buf_.resize(nc);
+		for (int i = 0; i < nc; i++) {
+			// static safety is in [0,1], so the cost with it set to 0 is a lower bound
+			candidates_[i].SetStaticSafety(0.0f);
+			candidates_[i].SetHitsObstacle(false);
+			candidates_[i].SetSegmentationCost(0.0f);
+			lower_bound_buf_[i] = GetTotalCostOfCandidate(i);
+			order_buf_[i] = i;
+		}
+		const float *lower_bound = lower_bound_buf_.data();
+		std::sort(order_buf_.begin(), order_buf_.end(), [lower_bound](int i, int j) {
+			return lower_bound[i] < lower_bound[j] || (lower_bound[i] == lower_bound[j] && i < j);
+		});
+		lowest_index = SelectCandidateBranchAndBound(true);
+		if (lowest_index == -1) { // pick a path that leaves the lane
+			lowest_index = SelectCandidateBranchAndBound(false);
+		}
+	}
+	else {
+		AVT_341_SCOPED_TIMER(timing_, STAGE_STATIC_SAFETY);
+		EvaluateStaticSafety(0);
+		int nc = (int)candidates_.size();
+		for (int i = 0; i < nc; i++) BlendStaticSafety(i);
+		lowest_index = SelectCandidate(true);
+		if (lowest_index == -1) { // pick a path that leaves the lane
+			lowest_index = SelectCandidate(false);
+		}
 	}
 
 	if (lowest_index == -1) {
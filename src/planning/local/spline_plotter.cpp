@@ -19,7 +19,7 @@ Plotter::Plotter(std::shared_ptr<avt_341::visualization::VisualizerBase> visuali
   visualizer_ = visualizer;
 }
 
-void Plotter::AddMap(avt_341::msg::OccupancyGrid grid){
+void Plotter::AddMap(const avt_341::msg::OccupancyGrid &grid){
 	grid_ = grid;
 	x_lo_ = grid.info.origin.position.x;
 	y_lo_ = grid.info.origin.position.y;
@@ -33,6 +33,20 @@ void Plotter::AddMap(avt_341::msg::OccupancyGrid grid){
 	map_set_ = true;
 }
 
+void Plotter::AddMap(const GridView &grid){
+	avt_341::msg::OccupancyGrid copy;
+	copy.info.width = grid.width;
+	copy.info.height = grid.height;
+	copy.info.resolution = grid.resolution;
+	copy.info.origin.position.x = grid.origin_x;
+	copy.info.origin.position.y = grid.origin_y;
+	copy.data.resize(grid.Size());
+	for (int i = 0; i < grid.width; i++) {
+		for (int j = 0; j < grid.height; j++) copy.data[i * grid.height + j] = grid.At(i, j);
+	}
+	AddMap(copy);
+}
+
 void Plotter::SetPath(std::vector<avt_341::utils::vec2> path) {
 	path_ = path;
 }
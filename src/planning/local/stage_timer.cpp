@@ -0,0 +1,61 @@
+#include "avt_341/planning/local/stage_timer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace avt_341 {
+namespace planning{
+
+StageTimingStats::StageTimingStats(int window) {
+	window_ = std::max(1, window);
+	stages_.resize(NUM_PLANNER_STAGES);
+	for (int i = 0; i < NUM_PLANNER_STAGES; i++) {
+		stages_[i].samples.reserve(window_);
+		stages_[i].next = 0;
+	}
+}
+
+void StageTimingStats::Add(int stage, double seconds) {
+	StageWindow &w = stages_[stage];
+	if ((int)w.samples.size() < window_) {
+		w.samples.push_back(seconds);
+	}
+	else {
+		w.samples[w.next] = seconds;
+		w.next = (w.next + 1) % window_;
+	}
+}
+
+StagePercentiles StageTimingStats::Percentiles(int stage) {
+	StagePercentiles p;
+	p.p50 = 0.0;
+	p.p95 = 0.0;
+	p.p99 = 0.0;
+	p.max = 0.0;
+	p.count = (int)stages_[stage].samples.size();
+	if (p.count == 0) return p;
+	// nearest rank percentiles, the selections leave scratch_ partitioned around each rank
+	scratch_ = stages_[stage].samples;
+	int n = p.count;
+	int r50 = std::min(n - 1, (int)ceil(0.50 * n) - 1);
+	int r95 = std::min(n - 1, (int)ceil(0.95 * n) - 1);
+	int r99 = std::min(n - 1, (int)ceil(0.99 * n) - 1);
+	std::nth_element(scratch_.begin(), scratch_.begin() + r50, scratch_.end());
+	p.p50 = scratch_[r50];
+	std::nth_element(scratch_.begin() + r50, scratch_.begin() + r95, scratch_.end());
+	p.p95 = scratch_[r95];
+	std::nth_element(scratch_.begin() + r95, scratch_.begin() + r99, scratch_.end());
+	p.p99 = scratch_[r99];
+	p.max = *std::max_element(scratch_.begin() + r99, scratch_.end());
+	return p;
+}
+
+const char *StageTimingStats::StageName(int stage) {
+	static const char *names[NUM_PLANNER_STAGES] = {
+		"path", "generate_paths", "dilate_grid", "path_samples", "comfort", "rho_cost",
+		"prepare_static", "dynamic_safety", "static_safety", "publish", "cycle"
+	};
+	return (stage >= 0 && stage < NUM_PLANNER_STAGES) ? names[stage] : "unknown";
+}
+
+} // namespace planning
+} // namespace avt_341
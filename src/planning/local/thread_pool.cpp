@@ -0,0 +1,78 @@
+#include "avt_341/planning/local/thread_pool.h"
+#include <algorithm>
+
+namespace avt_341 {
+namespace planning{
+
+ThreadPool::ThreadPool(int num_threads) {
+	task_ = nullptr;
+	task_first_ = 0;
+	task_last_ = 0;
+	num_chunks_ = 0;
+	task_id_ = 0;
+	pending_ = 0;
+	stop_ = false;
+	// the calling thread runs chunk 0, worker k runs chunk k+1
+	for (int k = 1; k < num_threads; k++) {
+		workers_.push_back(std::thread(&ThreadPool::WorkerLoop, this, k));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	work_cv_.notify_all();
+	for (int k = 0; k < (int)workers_.size(); k++) workers_[k].join();
+}
+
+int ThreadPool::ChunkStart(int chunk) const {
+	return task_first_ + (int)((long long)(task_last_ - task_first_) * chunk / num_chunks_);
+}
+
+void ThreadPool::ParallelFor(int first, int last, const std::function<void(int, int)> &func) {
+	int n = last - first;
+	if (n <= 0) return;
+	int num_chunks = std::min(GetNumThreads(), n);
+	if (num_chunks <= 1) {
+		func(first, last);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		task_ = &func;
+		task_first_ = first;
+		task_last_ = last;
+		num_chunks_ = num_chunks;
+		pending_ = num_chunks - 1;
+		task_id_++;
+	}
+	work_cv_.notify_all();
+	func(first, ChunkStart(1));
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_cv_.wait(lock, [this] { return pending_ == 0; });
+	task_ = nullptr;
+}
+
+void ThreadPool::WorkerLoop(int chunk) {
+	unsigned int seen = 0;
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		work_cv_.wait(lock, [this, seen] { return stop_ || task_id_ != seen; });
+		if (stop_) return;
+		seen = task_id_;
+		// short ranges use fewer chunks than threads
+		if (chunk >= num_chunks_) continue;
+		const std::function<void(int, int)> *task = task_;
+		int begin = ChunkStart(chunk);
+		int end = ChunkStart(chunk + 1);
+		lock.unlock();
+		(*task)(begin, end);
+		lock.lock();
+		if (--pending_ == 0) done_cv_.notify_one();
+	}
+}
+
+} // namespace planning
+} // namespace avt_341
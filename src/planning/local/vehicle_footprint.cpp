@@ -0,0 +1,135 @@
+#include "avt_341/planning/local/vehicle_footprint.h"
+#include <cmath>
+#include <algorithm>
+
+namespace avt_341 {
+namespace planning{
+
+VehicleFootprint::VehicleFootprint() {
+	length_ = 0.0f;
+	width_ = 0.0f;
+	nbins_ = 32;
+	mask_resolution_ = 0.0f;
+	words_per_column_ = 0;
+	width_cells_ = 0;
+	height_cells_ = 0;
+	bits_generation_ = 0;
+	bits_valid_ = false;
+}
+
+void VehicleFootprint::SetSize(float length, float width) {
+	if (length != length_ || width != width_) mask_resolution_ = 0.0f;
+	length_ = length;
+	width_ = width;
+}
+
+void VehicleFootprint::SetNumHeadingBins(int nbins) {
+	if (nbins < 1) nbins = 1;
+	if (nbins != nbins_) mask_resolution_ = 0.0f;
+	nbins_ = nbins;
+}
+
+float VehicleFootprint::CircumscribedRadius() const {
+	return 0.5f * sqrtf(length_*length_ + width_*width_);
+}
+
+float VehicleFootprint::Grow(float resolution) const {
+	// the path point can be anywhere in its cell and the heading anywhere in its bin,
+	// so the mask covers a cell diagonal of offset and half a bin of rotation
+	return (float)M_SQRT2 * resolution + CircumscribedRadius() * sinf(0.5f * (float)M_PI / nbins_);
+}
+
+float VehicleFootprint::MaskRadius(float resolution) const {
+	return CircumscribedRadius() + Grow(resolution);
+}
+
+int VehicleFootprint::HeadingBin(float heading) const {
+	const float bin_size = (float)M_PI / nbins_;
+	int bin = (int)floorf(heading / bin_size + 0.5f) % nbins_;
+	if (bin < 0) bin += nbins_;
+	return bin;
+}
+
+void VehicleFootprint::BuildMasks(float resolution) {
+	// a cell is in the mask if its center is inside the grown footprint, so every cell
+	// the rectangle touches is included for any position in the center cell and heading in the bin
+	const float grow = Grow(resolution);
+	const float hl = 0.5f * length_ + grow;
+	const float hw = 0.5f * width_ + grow;
+	const int r = (int)ceilf(MaskRadius(resolution) / resolution);
+	masks_.assign(nbins_, std::vector<MaskColumn>());
+	for (int b = 0; b < nbins_; b++) {
+		float theta = b * (float)M_PI / nbins_;
+		float ct = cosf(theta);
+		float st = sinf(theta);
+		for (int di = -r; di <= r; di++) {
+			MaskColumn col;
+			col.di = di;
+			col.jlo = r + 1;
+			col.jhi = -r - 1;
+			for (int dj = -r; dj <= r; dj++) {
+				float x = di * resolution;
+				float y = dj * resolution;
+				float along = ct*x + st*y;
+				float across = -st*x + ct*y;
+				if (fabsf(along) <= hl && fabsf(across) <= hw) {
+					col.jlo = std::min(col.jlo, dj);
+					col.jhi = std::max(col.jhi, dj);
+				}
+			}
+			if (col.jlo <= col.jhi) masks_[b].push_back(col);
+		}
+	}
+	mask_resolution_ = resolution;
+}
+
+void VehicleFootprint::Update(const GridView &grid, unsigned int generation) {
+	if (!Enabled() || grid.Empty()) return;
+	if (mask_resolution_ != grid.resolution) BuildMasks(grid.resolution);
+	if (bits_valid_ && generation == bits_generation_ && width_cells_ == grid.width && height_cells_ == grid.height) return;
+
+	width_cells_ = grid.width;
+	height_cells_ = grid.height;
+	words_per_column_ = (grid.height + 63) / 64;
+	bits_.assign(width_cells_ * words_per_column_, 0);
+	for (int i = 0; i < width_cells_; i++) {
+		uint64_t *words = bits_.data() + i * words_per_column_;
+		for (int j = 0; j < height_cells_; j++) {
+			if (grid.At(i, j) > 0) words[j >> 6] |= (uint64_t)1 << (j & 63);
+		}
+	}
+	bits_generation_ = generation;
+	bits_valid_ = true;
+}
+
+bool VehicleFootprint::AnySet(int col, int j0, int j1) const {
+	// test bits j0..j1 (inclusive) of one column
+	const uint64_t *words = bits_.data() + col * words_per_column_;
+	int w0 = j0 >> 6;
+	int w1 = j1 >> 6;
+	uint64_t lo_mask = ~(uint64_t)0 << (j0 & 63);
+	uint64_t hi_mask = ~(uint64_t)0 >> (63 - (j1 & 63));
+	if (w0 == w1) return (words[w0] & lo_mask & hi_mask) != 0;
+	if (words[w0] & lo_mask) return true;
+	for (int w = w0 + 1; w < w1; w++) {
+		if (words[w]) return true;
+	}
+	return (words[w1] & hi_mask) != 0;
+}
+
+bool VehicleFootprint::Collides(int ix, int iy, int bin) const {
+	if (!bits_valid_) return false;
+	const std::vector<MaskColumn> &mask = masks_[bin];
+	for (int k = 0; k < (int)mask.size(); k++) {
+		int col = ix + mask[k].di;
+		if (col < 0 || col >= width_cells_) continue;
+		int j0 = std::max(0, iy + mask[k].jlo);
+		int j1 = std::min(height_cells_ - 1, iy + mask[k].jhi);
+		if (j0 > j1) continue;
+		if (AnySet(col, j0, j1)) return true;
+	}
+	return false;
+}
+
+} // namespace planning
+} // namespace avt_341
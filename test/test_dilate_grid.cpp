@@ -0,0 +1,143 @@
+/**
+ * \file test_dilate_grid.cpp
+ *
+ * Compares Planner::DilateGrid, a separable running max, with a naive
+ * max filter over the square mask on random grids. Odd and even factors
+ * are used, with regions that touch or cross the edges of the grid.
+ *
+ * \date 10/17/2026
+ */
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "avt_341/planning/local/spline_planner.h"
+
+namespace {
+
+const float kResolution = 0.5f;
+const float kOriginX = -3.0f;
+const float kOriginY = 2.0f;
+
+avt_341::msg::OccupancyGridConstPtr RandomGrid(std::mt19937 &rng, int width, int height) {
+	avt_341::msg::OccupancyGrid *grid = new avt_341::msg::OccupancyGrid;
+	grid->info.width = width;
+	grid->info.height = height;
+	grid->info.resolution = kResolution;
+	grid->info.origin.position.x = kOriginX;
+	grid->info.origin.position.y = kOriginY;
+	grid->data.resize(width * height);
+	// mostly free cells, with obstacles of any cost and unknown cells
+	for (int n = 0; n < width * height; n++) {
+		int r = (int)(rng() % 20);
+		if (r < 2) grid->data[n] = (int8_t)(1 + rng() % 100);
+		else if (r < 4) grid->data[n] = -1;
+		else grid->data[n] = 0;
+	}
+	return avt_341::msg::OccupancyGridConstPtr(grid);
+}
+
+// dilates the grid with a max over the (2x+1)*(2x+1) mask, clipped to the
+// grid, for the cells of region [ix, imax_x) x [iy, imax_y), like DilateGrid
+int8_t NaiveDilation(const avt_341::msg::OccupancyGrid &grid, int x, int ix, int iy, int imax_x, int imax_y, int i, int j) {
+	int w = grid.info.width;
+	int h = grid.info.height;
+	if (i < ix || i >= imax_x || j < iy || j >= imax_y) return grid.data[i * h + j];
+	int8_t v = grid.data[i * h + j];
+	for (int a = std::max(0, i - x); a <= std::min(w - 1, i + x); a++) {
+		for (int b = std::max(0, j - x); b <= std::min(h - 1, j + x); b++) {
+			v = std::max(v, grid.data[a * h + b]);
+		}
+	}
+	return v;
+}
+
+void CheckRegion(const avt_341::msg::OccupancyGridConstPtr &grid, int x, int cx0, int cy0, int cx1, int cy1) {
+	// corners of the region in meters, on cell edges so the cell range is exact
+	float llx = kOriginX + cx0 * kResolution;
+	float lly = kOriginY + cy0 * kResolution;
+	float urx = kOriginX + cx1 * kResolution;
+	float ury = kOriginY + cy1 * kResolution;
+	avt_341::planning::Planner planner;
+	planner.SetGrid(grid);
+	planner.DilateGrid(x, llx, lly, urx, ury);
+
+	int w = grid->info.width;
+	int h = grid->info.height;
+	int ix = std::max(0, cx0);
+	int iy = std::max(0, cy0);
+	int imax_x = std::min(w, cx1);
+	int imax_y = std::min(h, cy1);
+	const avt_341::planning::GridView &view = planner.GetGrid();
+	ASSERT_EQ(view.width, w);
+	ASSERT_EQ(view.height, h);
+	for (int i = 0; i < w; i++) {
+		for (int j = 0; j < h; j++) {
+			ASSERT_EQ(view.At(i, j), NaiveDilation(*grid, x, ix, iy, imax_x, imax_y, i, j))
+				<< "cell " << i << "," << j << " factor " << x << " region " << cx0 << "," << cy0 << " " << cx1 << "," << cy1;
+		}
+	}
+	// the received grid is left untouched
+	EXPECT_EQ(view.data, grid->data.data());
+}
+
+} // namespace
+
+TEST(DilateGrid, MatchesNaiveMaxFilterOnFullGrid) {
+	std::mt19937 rng(1);
+	for (int x = 1; x <= 6; x++) {
+		for (int trial = 0; trial < 5; trial++) {
+			int w = 1 + (int)(rng() % 40);
+			int h = 1 + (int)(rng() % 40);
+			CheckRegion(RandomGrid(rng, w, h), x, 0, 0, w, h);
+		}
+	}
+}
+
+TEST(DilateGrid, MatchesNaiveMaxFilterOnWindows) {
+	std::mt19937 rng(2);
+	for (int trial = 0; trial < 200; trial++) {
+		int x = 1 + (int)(rng() % 6);
+		int w = 1 + (int)(rng() % 50);
+		int h = 1 + (int)(rng() % 50);
+		// regions may start before and end after the grid
+		int cx0 = (int)(rng() % (w + 4)) - 2;
+		int cy0 = (int)(rng() % (h + 4)) - 2;
+		int cx1 = cx0 + 1 + (int)(rng() % (w + 2));
+		int cy1 = cy0 + 1 + (int)(rng() % (h + 2));
+		CheckRegion(RandomGrid(rng, w, h), x, cx0, cy0, cx1, cy1);
+	}
+}
+
+TEST(DilateGrid, WindowsAtTheGridEdges) {
+	std::mt19937 rng(3);
+	const int w = 31;
+	const int h = 24;
+	avt_341::msg::OccupancyGridConstPtr grid = RandomGrid(rng, w, h);
+	for (int x = 1; x <= 4; x++) {
+		CheckRegion(grid, x, 0, 0, 5, 5);
+		CheckRegion(grid, x, w - 5, h - 5, w, h);
+		CheckRegion(grid, x, 0, h - 3, w, h);
+		CheckRegion(grid, x, w - 1, 0, w, h);
+		CheckRegion(grid, x, 10, 10, 11, 11);
+	}
+}
+
+TEST(DilateGrid, FactorLargerThanTheGrid) {
+	std::mt19937 rng(4);
+	avt_341::msg::OccupancyGridConstPtr grid = RandomGrid(rng, 7, 4);
+	CheckRegion(grid, 9, 0, 0, 7, 4);
+	CheckRegion(grid, 10, 2, 1, 5, 3);
+}
+
+TEST(DilateGrid, ZeroFactorOrEmptyRegionKeepsTheGrid) {
+	std::mt19937 rng(5);
+	avt_341::msg::OccupancyGridConstPtr grid = RandomGrid(rng, 12, 9);
+	CheckRegion(grid, 0, 0, 0, 12, 9);
+	CheckRegion(grid, 3, 20, 20, 25, 25);
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,141 @@
+/**
+ * \file test_dynamic_safety.cpp
+ *
+ * Compares the dynamic safety of the candidates found by the coarse to fine
+ * check, which skips the samples between coarse samples far from any obstacle,
+ * with checking every sample, on random scenes of moving obstacles. Fast
+ * obstacles cross the candidates between coarse samples, and scenes without
+ * any obstacle near a candidate check that nothing is skipped wrongly.
+ *
+ * \date 10/17/2026
+ */
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "avt_341/planning/local/spline_planner.h"
+
+namespace {
+
+// free grid around the origin, the static costs do not matter here
+avt_341::msg::OccupancyGridConstPtr FreeGrid() {
+	avt_341::msg::OccupancyGrid *grid = new avt_341::msg::OccupancyGrid;
+	grid->info.width = 240;
+	grid->info.height = 240;
+	grid->info.resolution = 0.5f;
+	grid->info.origin.position.x = -60.0f;
+	grid->info.origin.position.y = -60.0f;
+	grid->data.assign(240 * 240, 0);
+	return avt_341::msg::OccupancyGridConstPtr(grid);
+}
+
+// a centerline from the origin along x, bending with the given curvature
+avt_341::planning::Path Centerline(float curvature) {
+	std::vector<avt_341::utils::vec2> points;
+	float x = 0.0f, y = 0.0f, heading = 0.0f;
+	for (int i = 0; i < 60; i++) {
+		points.push_back(avt_341::utils::vec2(x, y));
+		x += cosf(heading);
+		y += sinf(heading);
+		heading += curvature;
+	}
+	return avt_341::planning::Path(points);
+}
+
+std::vector<float> DynamicSafety(avt_341::planning::Planner &planner, int stride, const avt_341::msg::Odometry &odom) {
+	planner.SetDynamicSafetyStride(stride);
+	planner.CalculateCandidateCosts(odom);
+	std::vector<avt_341::planning::Candidate> candidates = planner.GetCandidates();
+	std::vector<float> safety(candidates.size());
+	for (int i = 0; i < (int)candidates.size(); i++) safety[i] = candidates[i].GetDynamicSafety();
+	return safety;
+}
+
+} // namespace
+
+TEST(DynamicSafety, CoarseToFineMatchesEverySample) {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const float ds_settings[3] = { 0.1f, 0.25f, 0.5f };
+	avt_341::msg::OccupancyGridConstPtr grid = FreeGrid();
+	int with_cost = 0;
+	int total = 0;
+	for (int trial = 0; trial < 60; trial++) {
+		avt_341::planning::Path path = Centerline(0.03f*(2.0f*unit(rng) - 1.0f));
+		avt_341::planning::Planner planner;
+		planner.SetArcLengthIntegrationStep(ds_settings[trial % 3]);
+		planner.SetDynamicObstacleParams(0.5f + 1.5f*unit(rng), 1.0f + 3.0f*unit(rng), 2.0f + 4.0f*unit(rng));
+		planner.SetCenterline(path);
+		planner.GeneratePaths(21, 0.0f, 0.5f*(2.0f*unit(rng) - 1.0f), 0.0f, 30.0f, 0.5f, 2.0f);
+		planner.SetGrid(grid);
+
+		// obstacles ahead of the vehicle, some of them much faster than it
+		std::vector<avt_341::planning::DynamicObstacle> obstacles(1 + rng() % 6);
+		for (int j = 0; j < (int)obstacles.size(); j++) {
+			float speed = (j % 2 == 0 ? 20.0f : 3.0f)*unit(rng);
+			float dir = 6.2832f*unit(rng);
+			obstacles[j].x = 40.0f*unit(rng);
+			obstacles[j].y = 30.0f*(2.0f*unit(rng) - 1.0f);
+			obstacles[j].vx = speed*cosf(dir);
+			obstacles[j].vy = speed*sinf(dir);
+			obstacles[j].radius = 0.2f + 0.8f*unit(rng);
+		}
+		planner.SetDynamicObstacles(obstacles);
+
+		avt_341::msg::Odometry odom;
+		odom.twist.twist.linear.x = trial % 5 == 0 ? 0.0f : 10.0f*unit(rng);
+		odom.pose.pose.orientation.w = 1.0f;
+
+		std::vector<float> every = DynamicSafety(planner, 1, odom);
+		for (int stride = 2; stride <= 8; stride *= 2) {
+			std::vector<float> pruned = DynamicSafety(planner, stride, odom);
+			ASSERT_EQ(pruned.size(), every.size());
+			for (int i = 0; i < (int)every.size(); i++) {
+				EXPECT_EQ(pruned[i], every[i]) << "trial " << trial << " stride " << stride << " candidate " << i;
+			}
+		}
+		for (int i = 0; i < (int)every.size(); i++) with_cost += every[i] > 0.0f ? 1 : 0;
+		total += (int)every.size();
+	}
+	// the scenes must exercise both outcomes
+	EXPECT_GT(with_cost, total / 10);
+	EXPECT_LT(with_cost, total);
+}
+
+TEST(DynamicSafety, FastObstacleBetweenCoarseSamples) {
+	// the obstacle crosses the straight centerline once, far from both ends of a coarse stride
+	avt_341::planning::Path path = Centerline(0.0f);
+	avt_341::msg::OccupancyGridConstPtr grid = FreeGrid();
+	avt_341::msg::Odometry odom;
+	odom.twist.twist.linear.x = 5.0f;
+	odom.pose.pose.orientation.w = 1.0f;
+	for (int k = 0; k < 40; k++) {
+		avt_341::planning::Planner planner;
+		planner.SetArcLengthIntegrationStep(0.5f);
+		planner.SetDynamicObstacleParams(0.5f, 0.5f, 5.0f);
+		planner.SetCenterline(path);
+		planner.GeneratePaths(5, 0.0f, 0.0f, 0.0f, 25.0f, 0.5f, 2.0f);
+		planner.SetGrid(grid);
+		// at x = 2.5 + 0.25 k, reached at t = x/5, moving across at 30 m/s
+		std::vector<avt_341::planning::DynamicObstacle> obstacles(1);
+		float x = 2.5f + 0.25f*k;
+		obstacles[0].x = x;
+		obstacles[0].vx = 0.0f;
+		obstacles[0].vy = 30.0f;
+		obstacles[0].y = -30.0f*x / 5.0f;
+		obstacles[0].radius = 0.3f;
+		planner.SetDynamicObstacles(obstacles);
+
+		std::vector<float> every = DynamicSafety(planner, 1, odom);
+		std::vector<float> pruned = DynamicSafety(planner, 4, odom);
+		ASSERT_EQ(pruned.size(), every.size());
+		for (int i = 0; i < (int)every.size(); i++) {
+			EXPECT_EQ(pruned[i], every[i]) << "crossing at " << x << " candidate " << i;
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}